@@ -0,0 +1,73 @@
+// Name lookups from the body of deeply nested lambdas,
+// `let f_2 = a -> b -> c -> ...` of functions.ws taken to a depth of 10^4
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "annotation.hpp"
+#include "session.hpp"
+#include "source.hpp"
+#include "parsing/lexing.hpp"
+#include "parsing/literals.hpp"
+#include "parsing/parsing.hpp"
+
+
+namespace
+{
+  using namespace akbit::system;
+
+  constexpr int rounds = 3;
+  /// Names the innermost body looks up, spread over the depth
+  constexpr std::size_t names = 1000;
+
+  /// `let g = 1` and `let f_2 = a0 -> a1 -> ... -> (a0, a9, ..., g)`,
+  /// the body refers to parameters of every depth and to a global
+  std::string make_module(std::size_t depth, std::size_t lookups)
+  {
+    std::string text = "let g = 1\nlet f_2 = ";
+    for (std::size_t i = 0; i < depth; ++i)
+      text += "a" + std::to_string(i) + " -> ";
+
+    text += "(";
+    for (std::size_t i = 0; i < lookups; ++i)
+      text += "a" + std::to_string(i * depth / lookups) + ", ";
+    return text + "g)\n";
+  }
+
+  /// \return seconds annotating the module takes
+  double annotate_seconds(std::string const &text)
+  {
+    SourceBuffer source;
+    source.assign(text);
+
+    double best = 1e9;
+    for (int i = 0; i < rounds; ++i)
+    {
+      parsing::LiteralPool literals;
+      auto tokens = parsing::tokenize(source.text(), literals);
+
+      Session session;
+      auto module = parsing::parse(tokens, literals, source.text(), session);
+
+      auto start = std::chrono::steady_clock::now();
+      annotation::generate_context(module, session);
+      best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+  }
+}
+
+int main()
+{
+  // The scopes alone are annotated without the lookups, what is left is
+  // the cost of finding the names
+  std::printf("%8s %10s %14s %14s %16s\n", "depth", "lookups", "scopes (ms)", "total (ms)", "per lookup (us)");
+  for (std::size_t depth : { 1000, 2000, 5000, 10000 })
+  {
+    auto scopes = annotate_seconds(make_module(depth, 0));
+    auto total = annotate_seconds(make_module(depth, names));
+    std::printf("%8zu %10zu %14.2f %14.2f %16.3f\n", depth, names + 1, scopes * 1e3, total * 1e3, std::max(0.0, total - scopes) / (names + 1) * 1e6);
+  }
+}
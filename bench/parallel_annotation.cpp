@@ -0,0 +1,88 @@
+// Annotation of a module of 10^4 top-level functions, serial and on
+// a pool of 1 to N threads, N is the number of hardware threads unless given
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "annotation.hpp"
+#include "session.hpp"
+#include "source.hpp"
+#include "thread_pool.hpp"
+#include "parsing/lexing.hpp"
+#include "parsing/literals.hpp"
+#include "parsing/parsing.hpp"
+
+
+namespace
+{
+  using namespace akbit::system;
+
+  constexpr std::size_t functions = 10000;
+  constexpr int rounds = 3;
+
+  /// Functions with bodies of a few scopes that call other functions
+  std::string make_module()
+  {
+    std::string text;
+    for (std::size_t i = 0; i < functions; ++i)
+    {
+      auto f = "f" + std::to_string(i);
+      auto g = "f" + std::to_string(i * 7919 % functions);
+      text += "let " + f + " = (a, b) -> { let x = a * 3 + " + g + "(b, a)\n"
+              " let h = m -> if m > x then " + f + "(m - 1, b) + x else " + g + "(m, x) * 2\n"
+              " h(b) + (q -> q + x)(a) }\n";
+    }
+    return text;
+  }
+
+  /// \param threads 0 for the serial pass
+  double annotate_seconds(SourceBuffer const &source, std::size_t threads)
+  {
+    std::unique_ptr<ThreadPool> pool;
+    if (threads > 0)
+      pool = std::make_unique<ThreadPool>(threads);
+
+    double best = 1e9;
+    for (int i = 0; i < rounds; ++i)
+    {
+      parsing::LiteralPool literals;
+      auto tokens = parsing::tokenize(source.text(), literals);
+
+      Session session;
+      auto module = parsing::parse(tokens, literals, source.text(), session);
+
+      auto start = std::chrono::steady_clock::now();
+      annotation::generate_context(module, session, pool.get());
+      best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  std::size_t max_threads = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency()));
+
+  // Type mismatches of the generated module are reported to the error stream
+  std::cerr.setstate(std::ios::badbit);
+
+  SourceBuffer source;
+  source.assign(make_module());
+
+  std::printf("%zu functions, %zu KiB, %u hardware threads\n", functions, source.size() >> 10, std::thread::hardware_concurrency());
+  std::printf("%8s %14s %10s\n", "threads", "annotate (ms)", "speedup");
+
+  auto serial = annotate_seconds(source, 0);
+  std::printf("%8s %14.2f %10.2f\n", "serial", serial * 1e3, 1.0);
+  for (std::size_t threads = 1; threads <= max_threads; ++threads)
+  {
+    auto seconds = annotate_seconds(source, threads);
+    std::printf("%8zu %14.2f %10.2f\n", threads, seconds * 1e3, serial / seconds);
+  }
+}
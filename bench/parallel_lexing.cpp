@@ -0,0 +1,63 @@
+// Scaling of tokenize_parallel() from one thread to N,
+// N is the number of hardware threads unless it is given
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "source.hpp"
+#include "parsing/lexing.hpp"
+#include "parsing/literals.hpp"
+
+
+namespace
+{
+  using namespace akbit::system;
+
+  constexpr std::size_t text_size = 32 * 1024 * 1024;
+  constexpr int rounds = 3;
+
+  /// Text shaped like a generated module
+  std::string make_module()
+  {
+    std::string text;
+    for (std::size_t i = 0; text.size() < text_size; ++i)
+    {
+      auto n = std::to_string(i);
+      text += "let f" + n + " = (a, b) -> if a > 0 then f" + n + "(a - 1, b) + g" + std::to_string(i % 977) + "(b, a) else 2.5 * b\n";
+      text += "// generated from entry " + n + "\n";
+      text += "print(\"value of f" + n + ":\\t\", f" + n + "(3, 4), 'x)\n";
+    }
+    return text;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  std::size_t max_threads = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::max(1u, std::thread::hardware_concurrency()));
+
+  SourceBuffer source;
+  source.assign(make_module());
+
+  std::printf("%zu MiB, %u hardware threads\n", source.size() >> 20, std::thread::hardware_concurrency());
+  std::printf("%8s %12s %12s %10s\n", "threads", "time (ms)", "MB/s", "speedup");
+
+  double single = 0;
+  for (std::size_t threads = 1; threads <= max_threads; ++threads)
+  {
+    double best = 1e9;
+    for (int i = 0; i < rounds; ++i)
+    {
+      parsing::LiteralPool literals;
+      auto start = std::chrono::steady_clock::now();
+      auto tokens = parsing::tokenize_parallel(source.text(), literals, threads);
+      best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    if (threads == 1) single = best;
+
+    std::printf("%8zu %12.1f %12.1f %10.2f\n", threads, best * 1e3, source.size() / best / 1e6, single / best);
+  }
+}
@@ -0,0 +1,116 @@
+// Throughput of the lexer for every class of token,
+// through tokenize() and through the bare run-skipping kernels
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "source.hpp"
+#include "parsing/lexing.hpp"
+#include "parsing/literals.hpp"
+#include "parsing/scanning.hpp"
+
+
+namespace
+{
+  using namespace akbit::system;
+  using parsing::ScanKernels;
+
+  using kernel_t = char const *(*ScanKernels::*)(char const *);
+
+  constexpr std::size_t text_size = 16 * 1024 * 1024;
+  constexpr int rounds = 3;
+
+  struct token_class_t
+  {
+    char const *name;
+    /// Piece that is repeated to fill the text
+    std::string piece;
+    /// Kernel that skips the bodies of the tokens, nullptr if there is none
+    kernel_t kernel;
+    /// Bytes of the piece before the run the kernel skips
+    std::size_t run_offset;
+  };
+
+  std::string repeat(std::string const &piece)
+  {
+    std::string text;
+    text.reserve(text_size + piece.size());
+    while (text.size() < text_size)
+      text += piece;
+    return text;
+  }
+
+  template <typename F>
+  double best_seconds(F &&run)
+  {
+    double best = 1e9;
+    for (int i = 0; i < rounds; ++i)
+    {
+      auto start = std::chrono::steady_clock::now();
+      run();
+      best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+  }
+
+  /// \return MB/s of a kernel over the runs of the text, one call per piece
+  double kernel_speed(ScanKernels const &kernels, token_class_t const &token_class, SourceBuffer const &source)
+  {
+    auto text = source.text();
+    std::size_t skipped = 0;
+    auto seconds = best_seconds([&] {
+      skipped = 0;
+      for (std::size_t at = token_class.run_offset; at < text.size(); at += token_class.piece.size())
+      {
+        auto end = (kernels.*token_class.kernel)(text.data() + at);
+        skipped += static_cast<std::size_t>(end - (text.data() + at));
+      }
+    });
+    return (skipped == 0 ? 0.0 : text.size() / seconds / 1e6);
+  }
+}
+
+int main()
+{
+  std::string identifier(60, 'a');
+  std::string digits(60, '7');
+  std::string body(60, 'x');
+
+  std::vector<token_class_t> classes{
+    { "whitespace",   "a" + std::string(63, ' '),       &ScanKernels::skip_whitespace,  1 },
+    { "identifier",   identifier + "\n",                 &ScanKernels::skip_identifier,  1 },
+    { "integer",      digits + "\n",                     &ScanKernels::skip_digits,      1 },
+    { "decimal",      digits + "." + digits + "\n",      &ScanKernels::skip_digits,      1 },
+    { "string",       "\"" + body + "\"\n",              &ScanKernels::skip_string_body, 1 },
+    { "escaped",      "\"" + body + "\\n\"\n",           &ScanKernels::skip_string_body, 1 },
+    { "character",    "'x ",                             nullptr,                        0 },
+    { "operator",     "+ - * / == != <= >= && || -> ",   nullptr,                        0 },
+    { "comment",      "//" + body + "\n",                &ScanKernels::skip_line,        2 },
+  };
+
+  auto const &scalar = parsing::get_scalar_scan_kernels();
+  auto const &best = parsing::get_scan_kernels();
+
+  std::printf("%-12s %12s %12s %14s %14s\n", "class", "tokens", "lex (MB/s)", "scalar (MB/s)", "kernel (MB/s)");
+  for (auto &token_class : classes)
+  {
+    SourceBuffer source;
+    source.assign(repeat(token_class.piece));
+
+    std::size_t count = 0;
+    auto seconds = best_seconds([&] {
+      parsing::LiteralPool literals;
+      count = parsing::tokenize(source.text(), literals).size();
+    });
+
+    std::printf("%-12s %12zu %12.1f", token_class.name, count, source.size() / seconds / 1e6);
+    if (token_class.kernel)
+      std::printf(" %14.1f %14.1f\n", kernel_speed(scalar, token_class, source), kernel_speed(best, token_class, source));
+    else
+      std::printf(" %14s %14s\n", "-", "-");
+  }
+  std::printf("kernels: %s\n", best.name);
+}
@@ -3,13 +3,45 @@
 #ifndef AKBIT__SYSTEM__ANNOTATION_HPP
 #define AKBIT__SYSTEM__ANNOTATION_HPP
 
+#include <vector>
+
 #include "node.hpp"
+#include "session.hpp"
+#include "symbols.hpp"
+
 
+namespace akbit::system
+{
+  class ThreadPool;
+  struct Context;
+  struct DeclarationRecord;
+}
 
 namespace akbit::system::annotation
 {
-  void preprocess_ast(std::shared_ptr<Node> node);
-  void generate_context(std::shared_ptr<Node> node);
+  /// Name of a statement that is not declared in one of its own scopes,
+  /// so that it is looked up among the global declarations
+  struct global_lookup_t
+  {
+    symbol_t name;
+    /// Global declaration found, nullptr if there is none
+    DeclarationRecord const * record;
+  };
+
+  /// Resolves the names of the tree and works out the types of its nodes
+  /// \param pool if given, the values of global declarations that are functions
+  ///             are annotated on its threads after the rest of the module.
+  ///             The result is the same as without it, context ids included
+  void generate_context(Node * node, Session &session, ThreadPool * pool = nullptr);
+
+  /// Annotates a top-level statement of a module that is compiled
+  /// one statement at a time. The global declarations of the statement
+  /// are added to `global` and stay there for the statements after it
+  /// \param session owns the other contexts of the statement,
+  ///                it can be reset once the statement is done
+  /// \param lookups if given, receives the names the statement looks up
+  ///                among the global declarations, in the order they are met
+  void generate_context(Node * statement, Context * global, Session &session, std::vector<global_lookup_t> * lookups = nullptr);
 }
 
 #endif
@@ -1,212 +1,462 @@
+#include <deque>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include "../annotation.hpp"
 #include "../node.hpp"
 #include "../context.hpp"
+#include "../traversal.hpp"
+#include "../symbols.hpp"
+#include "../thread_pool.hpp"
+#include "../error_handling.hpp"
 
 
 namespace akbit::system::annotation
 {
   namespace
   {
-    template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
-    template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
-
-    // Context generation visitors
-    void cg_visit(std::shared_ptr<Node> node, std::shared_ptr<Context> ctx, bool reg_vars);
-
-    void cg_visit_module(std::shared_ptr<Node> node, Node::module_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
-    void cg_visit_declaration(std::shared_ptr<Node> node, Node::declaration_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
-    void cg_visit_condition(std::shared_ptr<Node> node, Node::condition_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
-    void cg_visit_block(std::shared_ptr<Node> node, Node::block_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
-    void cg_visit_unary_operation(std::shared_ptr<Node> node, Node::unary_operation_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
-    void cg_visit_binary_operation(std::shared_ptr<Node> node, Node::binary_operation_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
-    void cg_visit_function_call(std::shared_ptr<Node> node, Node::function_call_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
+    /// Node whose annotation is in progress
+    struct frame_t
+    {
+      Node * node;
+      Context * ctx;
+      bool reg_vars;
+      /// Children visited so far
+      std::size_t step;
+    };
+
+    /// Child to annotate before the node goes on
+    struct visit_t
+    {
+      Node * node;
+      Context * ctx;
+      bool reg_vars;
+    };
+
+    /// Part a walk takes in the parallel annotation of the global scope
+    struct task_t
+    {
+      /// Value of a global declaration that another walk annotates
+      Node const * deferred = nullptr;
+      /// Receives the messages written after the deferred value is met,
+      /// the ones of the value itself are written by the other walk in between
+      std::ostream * after_deferred = nullptr;
+      /// Global declaration whose value this walk annotates.
+      /// Its record already has the type of the value for the other walks,
+      /// while the value itself sees the declared type, as in the serial order
+      DeclarationRecord const * record = nullptr;
+      Node::etype_t type = Node::etype_t::unknown;
+
+      /// Session the contexts of the walk are made from,
+      /// if not the one of the context they are made in
+      Session * session = nullptr;
+
+      /// Receives the names the walk looks up among the global declarations
+      std::vector<global_lookup_t> * lookups = nullptr;
+    };
+
+    /// Annotates the subtree of a node in the scope it is given
+    void annotate(visit_t const &root, task_t const &task);
+
+    /// \return type that the declaration states, unknown if none
+    Node::etype_t declared_type(Node::declaration_t const &val);
+
+    /// \return number of contexts the annotation of the subtree makes
+    std::uint64_t count_contexts(Node const * node);
+
+    // Context generation visitors.
+    // A visitor is called again after every child it asks for,
+    // it returns false once the node is done
+    bool cg_visit(Node &, Node::unknown_t &, frame_t &, task_t const &, visit_t &) { return false; }
+
+    bool cg_visit(Node &node, Node::module_t &val, frame_t &frame, task_t const &, visit_t &next);
+    bool cg_visit(Node &node, Node::declaration_t &val, frame_t &frame, task_t const &, visit_t &next);
+    bool cg_visit(Node &node, Node::condition_t &val, frame_t &frame, task_t const &, visit_t &next);
+    bool cg_visit(Node &node, Node::block_t &val, frame_t &frame, task_t const &, visit_t &next);
+    bool cg_visit(Node &node, Node::unary_operation_t &val, frame_t &frame, task_t const &, visit_t &next);
+    bool cg_visit(Node &node, Node::binary_operation_t &val, frame_t &frame, task_t const &, visit_t &next);
+    bool cg_visit(Node &node, Node::function_call_t &val, frame_t &frame, task_t const &, visit_t &next);
     
-    void cg_visit_value_function(std::shared_ptr<Node> node, Node::value_function_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
-    void cg_visit_value_tuple(std::shared_ptr<Node> node, Node::value_tuple_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
-    void cg_visit_value_variable(std::shared_ptr<Node> node, Node::value_variable_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
-    void cg_visit_value_string(std::shared_ptr<Node> node, Node::value_string_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
-    void cg_visit_value_character(std::shared_ptr<Node> node, Node::value_character_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
-    void cg_visit_value_integer(std::shared_ptr<Node> node, Node::value_integer_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
-    void cg_visit_value_decimal(std::shared_ptr<Node> node, Node::value_decimal_t &val, std::shared_ptr<Context> ctx, bool reg_vars);
+    bool cg_visit(Node &node, Node::value_function_t &val, frame_t &frame, task_t const &, visit_t &next);
+    bool cg_visit(Node &node, Node::value_tuple_t &val, frame_t &frame, task_t const &, visit_t &next);
+    bool cg_visit(Node &node, Node::value_variable_t &val, frame_t &frame, task_t const &task, visit_t &next);
+    bool cg_visit(Node &node, Node::value_string_t &val, frame_t &frame, task_t const &, visit_t &next);
+    bool cg_visit(Node &node, Node::value_character_t &val, frame_t &frame, task_t const &, visit_t &next);
+    bool cg_visit(Node &node, Node::value_integer_t &val, frame_t &frame, task_t const &, visit_t &next);
+    bool cg_visit(Node &node, Node::value_decimal_t &val, frame_t &frame, task_t const &, visit_t &next);
   }
 
-  void generate_context(std::shared_ptr<Node> node)
+  void generate_context(Node * node, Session &session, ThreadPool * pool)
   {
     if (nullptr == node) return;
-    cg_visit(node, std::make_shared<Context>(nullptr), false);
+
+    auto global = session.make<Context>(session, nullptr);
+    auto module = node->as<Node::module_t>();
+    if (nullptr == pool || nullptr == module)
+    {
+      annotate({ node, global, false }, {});
+      return;
+    }
+
+    node->context = global;
+    module->global_context = global;
+
+    struct job_t
+    {
+      Node::value_function_t * function;
+      Node * value;
+      task_t task;
+      /// Receives the messages of the value
+      std::ostream * messages;
+      /// Declarations of the global scope the value can see
+      std::size_t visible;
+      /// Id of the context made before the ones of the value
+      std::uint64_t last_id;
+    };
+
+    // Messages are kept in the order the serial pass writes them in and
+    // written out once the workers are done. The value of a deferred
+    // declaration gets the part between what the declaration writes before
+    // and after it
+    std::deque<std::ostringstream> messages;
+    auto output = capture_diagnostics(nullptr);
+
+    // Statements are annotated in order, except for the values of global
+    // declarations that are functions: those are left to the workers.
+    // Every statement gets the context ids it would get in the serial order
+    std::vector<job_t> jobs;
+    std::uint64_t last_id = global->id;
+    for (auto statement : module->data)
+    {
+      auto declaration = (nullptr != statement ? statement->as<Node::declaration_t>() : nullptr);
+      auto value = (nullptr != declaration ? declaration->value : nullptr);
+      auto function = (nullptr != value ? value->as<Node::value_function_t>() : nullptr);
+
+      session.restart_context_ids(last_id);
+      capture_diagnostics(&messages.emplace_back());
+      if (nullptr == function)
+      {
+        annotate({ statement, global, false }, {});
+        last_id += count_contexts(statement);
+        continue;
+      }
+
+      // The declaration takes the type of the function before it is annotated
+      auto &value_messages = messages.emplace_back();
+      value->result_type = Node::etype_t::function;
+      annotate({ statement, global, false }, { .deferred = value, .after_deferred = &messages.emplace_back() });
+
+      auto record = declaration->variable->as<Node::value_variable_t>()->record;
+      auto value_contexts = count_contexts(value);
+      last_id += count_contexts(statement);
+      jobs.push_back({ function, value, { .record = record, .type = declared_type(*declaration) }, &value_messages, global->declarations.size(), last_id - value_contexts });
+    }
+    session.restart_context_ids(last_id);
+    capture_diagnostics(output);
+
+    // Workers allocate from sessions of their own, that live as long as the main one
+    std::vector<Session *> sessions;
+    for (std::size_t i = 0; i < pool->size(); ++i)
+      sessions.push_back(session.make<Session>());
+
+    for (auto &job : jobs)
+    {
+      pool->submit([&job, &sessions, global](std::size_t worker) {
+        auto &local = *sessions[worker];
+        local.restart_context_ids(job.last_id);
+        job.function->owned_context = local.make<Context>(local, global, job.visible);
+
+        auto previous = capture_diagnostics(job.messages);
+        annotate({ job.value, global, false }, job.task);
+        capture_diagnostics(previous);
+      });
+    }
+    pool->wait();
+
+    auto &out = diagnostics(std::cerr);
+    for (auto &part : messages)
+      out << part.view();
+  }
+
+  void generate_context(Node * statement, Context * global, Session &session, std::vector<global_lookup_t> * lookups)
+  {
+    if (nullptr == statement) return;
+
+    // Contexts are numbered on from the ones of the earlier statements
+    session.restart_context_ids(global->session.last_context_id());
+    annotate({ statement, global, false }, { .session = &session, .lookups = lookups });
+    global->session.restart_context_ids(session.last_context_id());
   }
 
   namespace
   {
-    void cg_visit(std::shared_ptr<Node> node, std::shared_ptr<Context> ctx, bool reg_vars)
+    void annotate(visit_t const &root, task_t const &task)
     {
-      if (nullptr == node) return;
+      // Nodes are annotated on a stack on the heap,
+      // so the depth of the tree is not limited by the native stack
+      std::vector<frame_t> frames;
+      auto visit = [&](visit_t const &child) {
+        if (nullptr == child.node) return;
+        if (task.deferred == child.node)
+        {
+          if (nullptr != task.after_deferred)
+            capture_diagnostics(task.after_deferred);
+          return;
+        }
+
+        child.node->context = child.ctx;
+        frames.push_back({ child.node, child.ctx, child.reg_vars, 0 });
+      };
 
-      node->context = ctx;
-      std::visit(overloaded {
-        [&](auto                     & ) {                                                       },
-        [&](Node::module_t           &_) { cg_visit_module(node, _, ctx, reg_vars);              },
-        [&](Node::declaration_t      &_) { cg_visit_declaration(node, _, ctx, reg_vars);         },
-        [&](Node::condition_t        &_) { cg_visit_condition(node, _, ctx, reg_vars);           },
-        [&](Node::block_t            &_) { cg_visit_block(node, _, ctx, reg_vars);               },
-        [&](Node::unary_operation_t  &_) { cg_visit_unary_operation(node, _, ctx, reg_vars);     },
-        [&](Node::binary_operation_t &_) { cg_visit_binary_operation(node, _, ctx, reg_vars);    },
-        [&](Node::function_call_t    &_) { cg_visit_function_call(node, _, ctx, reg_vars);       },
-        [&](Node::value_function_t   &_) { cg_visit_value_function(node, _, ctx, reg_vars);      },
-        [&](Node::value_tuple_t      &_) { cg_visit_value_tuple(node, _, ctx, reg_vars);         },
-        [&](Node::value_variable_t   &_) { cg_visit_value_variable(node, _, ctx, reg_vars);      },
-        [&](Node::value_string_t     &_) { cg_visit_value_string(node, _, ctx, reg_vars);        },
-        [&](Node::value_character_t  &_) { cg_visit_value_character(node, _, ctx, reg_vars);     },
-        [&](Node::value_integer_t    &_) { cg_visit_value_integer(node, _, ctx, reg_vars);       },
-        [&](Node::value_decimal_t    &_) { cg_visit_value_decimal(node, _, ctx, reg_vars);       },
-      }, node->value);
+      visit(root);
+      while (!frames.empty())
+      {
+        auto &frame = frames.back();
+        visit_t next{};
+
+        if (dispatch(*frame.node, [&](Node &n, auto &val) { return cg_visit(n, val, frame, task, next); }))
+          visit(next);
+        else
+          frames.pop_back();
+      }
     }
 
-    void cg_visit_module(std::shared_ptr<Node>, Node::module_t &val, std::shared_ptr<Context> ctx, bool reg_vars)
+    Node::etype_t declared_type(Node::declaration_t const &val)
     {
-      val.global_context = ctx;
-      for (auto d : val.data)
-        cg_visit(d, ctx, reg_vars);
+      // TODO: Make a normal type checking
+      auto type_info = (val.type ? val.type->as<Node::value_variable_t>() : nullptr);
+      if (type_info && !type_info->record)
+      {
+        if (type_info->name == s_int) return Node::etype_t::integer;
+        if (type_info->name == s_float) return Node::etype_t::decimal;
+        if (type_info->name == s_string) return Node::etype_t::string;
+        if (type_info->name == s_function) return Node::etype_t::function;
+      }
+      return Node::etype_t::unknown;
     }
 
-    void cg_visit_declaration(std::shared_ptr<Node> node, Node::declaration_t &val, std::shared_ptr<Context> ctx, bool reg_vars)
+    std::uint64_t count_contexts(Node const * node)
     {
-      // Assumes that the assignee is a signle variable
-      // TODO: Enhance the code to support more assignment types
-      // TODO: Make a normal type checking
-      cg_visit(val.type, ctx, false);
-      auto t = Node::etype_t::unknown;
-      if (val.type && val.type->value.index() == 12)
+      std::uint64_t count = 0;
+      walk(node, [&](Node const * child, std::size_t) {
+        count += (nullptr != child && child->kind() == Node::k_value_function);
+      }, [](Node const *) { });
+      return count;
+    }
+  }
+
+  namespace
+  {
+    bool cg_visit(Node &, Node::module_t &val, frame_t &frame, task_t const &, visit_t &next)
+    {
+      if (frame.step == 0)
+        val.global_context = frame.ctx;
+
+      if (frame.step == val.data.size())
+        return false;
+
+      next = { val.data[frame.step++], frame.ctx, frame.reg_vars };
+      return true;
+    }
+
+    bool cg_visit(Node &node, Node::declaration_t &val, frame_t &frame, task_t const &, visit_t &next)
+    {
+      auto ctx = frame.ctx;
+      auto &variable = *val.variable->as<Node::value_variable_t>();
+
+      switch (frame.step++)
       {
-        auto type_info = std::get<Node::value_variable_t>(val.type->value);
-        if (!type_info.record.lock())
+        case 0:
+          next = { val.type, ctx, false };
+          return true;
+
+        case 1:
+        {
+          // Assumes that the assignee is a signle variable
+          // TODO: Enhance the code to support more assignment types
+          auto t = declared_type(val);
+
+          auto name = variable.name;
+          if (is_reserved_symbol(name))
+          {
+            // TODO: Handle error properly
+            diagnostics(std::cerr) << ("Reserved word '" + std::string(builtin_symbols[name]) + "' can not be declared.\n");
+          }
+
+          auto record = ctx->add(name, t);
+          node.result_type = t;
+          variable.record = record;
+
+          if (!val.value) return false;
+          next = { val.value, ctx, frame.reg_vars };
+          return true;
+        }
+
+        default:
         {
-          if (type_info.name == "int") t = Node::etype_t::integer;
-          else if (type_info.name == "float") t = Node::etype_t::decimal;
-          else if (type_info.name == "string") t = Node::etype_t::string;
-          else if (type_info.name == "function") t = Node::etype_t::function;
+          auto t = node.result_type;
+          auto rt = t != Node::etype_t::unknown ? t : val.value->result_type;
+          if (t != Node::etype_t::unknown && rt != t)
+          {
+            // TODO: Handle error properly
+            diagnostics(std::cerr) << "Mismatch between declared and assigned value types.\n";
+          }
+
+          variable.record->type = rt;
+          node.result_type = rt;
+          return false;
         }
       }
+    }
 
-      auto record = ctx->add(ctx, std::get<Node::value_variable_t>(val.variable->value).name, t);
-      node->result_type = t;
-      std::get<Node::value_variable_t>(val.variable->value).record = record;
-
-      if (!val.value) return;
-      cg_visit(val.value, ctx, reg_vars);
-      auto rt = t != Node::etype_t::unknown ? t : val.value->result_type;
-      if (t != Node::etype_t::unknown && rt != t)
+    bool cg_visit(Node &node, Node::condition_t &val, frame_t &frame, task_t const &, visit_t &next)
+    {
+      switch (frame.step++)
       {
-        // TODO: Handle error properly
-        std::cerr << "Mismatch between declared and assigned value types.\n";
+        case 0: next = { val.expression, frame.ctx, frame.reg_vars }; return true;
+        case 1: next = { val.clause_true, frame.ctx, frame.reg_vars }; return true;
+        case 2: next = { val.clause_false, frame.ctx, frame.reg_vars }; return true;
       }
 
-      record->type = rt;
-      node->result_type = rt;
+      node.result_type = Node::etype_t::any;
+      if (val.clause_false && val.clause_false->result_type != val.clause_true->result_type)
+        node.result_type = val.clause_false->result_type;
+      return false;
     }
 
-    void cg_visit_condition(std::shared_ptr<Node> node, Node::condition_t &val, std::shared_ptr<Context> ctx, bool reg_vars)
+    bool cg_visit(Node &, Node::block_t &val, frame_t &frame, task_t const &, visit_t &next)
     {
-      cg_visit(val.expression, ctx, reg_vars);
-      cg_visit(val.clause_true, ctx, reg_vars);
-      cg_visit(val.clause_false, ctx, reg_vars);
+      if (frame.step == val.code.size())
+        return false;
 
-      node->result_type = Node::etype_t::any;
-      if (val.clause_false && val.clause_false->result_type != val.clause_true->result_type)
-        node->result_type = val.clause_false->result_type;
+      next = { val.code[frame.step++], frame.ctx, frame.reg_vars };
+      return true;
     }
 
-    void cg_visit_block(std::shared_ptr<Node>, Node::block_t &val, std::shared_ptr<Context> ctx, bool reg_vars)
+    bool cg_visit(Node &node, Node::unary_operation_t &val, frame_t &frame, task_t const &, visit_t &next)
     {
-      auto rt = Node::etype_t::unknown;
-      for (auto stmt : val.code)
+      if (frame.step++ == 0)
       {
-        cg_visit(stmt, ctx, reg_vars);
-        rt = stmt->result_type;
+        next = { val.expression, frame.ctx, frame.reg_vars };
+        return true;
       }
-    }
 
-    void cg_visit_unary_operation(std::shared_ptr<Node> node, Node::unary_operation_t &val, std::shared_ptr<Context> ctx, bool reg_vars)
-    {
-      cg_visit(val.expression, ctx, reg_vars);
-      node->result_type = val.expression->result_type;
+      node.result_type = val.expression->result_type;
+      return false;
     }
 
-    void cg_visit_binary_operation(std::shared_ptr<Node> node, Node::binary_operation_t &val, std::shared_ptr<Context> ctx, bool reg_vars)
+    bool cg_visit(Node &node, Node::binary_operation_t &val, frame_t &frame, task_t const &, visit_t &next)
     {
-      bool is_first = true;
-      auto common_type = Node::etype_t::unknown;
-
-      for (auto operand : val.operands)
+      // The result type holds the common type of the operands seen so far
+      if (frame.step == 1)
       {
-        cg_visit(operand, ctx, reg_vars && (val.operation != find_operator(":") || is_first));
-        if (is_first) common_type = operand->result_type;
-        else
+        node.result_type = val.operands[0]->result_type;
+      }
+      else if (frame.step > 1)
+      {
+        auto common_type = node.result_type;
+        auto rt = val.operands[frame.step - 1]->result_type;
+        if (common_type != rt && rt != Node::etype_t::unknown && rt != Node::etype_t::any)
         {
-          auto rt = operand->result_type;
-          if (common_type != rt && rt != Node::etype_t::unknown && rt != Node::etype_t::any)
-          {
-            // TODO: Report error
-            std::cerr << "Binary operation type mismatch:\n  Expected <" << (int)common_type << ">, but <" << (int)rt << "> was given.\n";
-            common_type = Node::etype_t::any;
-          }
+          // TODO: Report error
+          diagnostics(std::cerr) << ("Binary operation type mismatch:\n  Expected <" + std::to_string((int)common_type) + ">, but <" + std::to_string((int)rt) + "> was given.\n");
+          node.result_type = Node::etype_t::any;
         }
-        
-        is_first = false;
       }
 
-      node->result_type = common_type;
+      if (frame.step == val.operands.size())
+      {
+        if (frame.step == 0) node.result_type = Node::etype_t::unknown;
+        return false;
+      }
+
+      bool is_first = (frame.step == 0);
+      next = { val.operands[frame.step++], frame.ctx, frame.reg_vars && (val.operation->id != op_type_cast || is_first) };
+      return true;
     }
 
-    void cg_visit_function_call(std::shared_ptr<Node> node, Node::function_call_t &val, std::shared_ptr<Context> ctx, bool reg_vars)
+    bool cg_visit(Node &node, Node::function_call_t &val, frame_t &frame, task_t const &, visit_t &next)
     {
-      cg_visit(val.expression, ctx, reg_vars);
-      cg_visit(val.arguments, ctx, reg_vars);
-      node->result_type = Node::etype_t::any;
+      switch (frame.step++)
+      {
+        case 0: next = { val.expression, frame.ctx, frame.reg_vars }; return true;
+        case 1: next = { val.arguments, frame.ctx, frame.reg_vars }; return true;
+      }
+
+      node.result_type = Node::etype_t::any;
+      return false;
     }
 
-    void cg_visit_value_function(std::shared_ptr<Node> node, Node::value_function_t &val, std::shared_ptr<Context> ctx, bool reg_vars)
+    bool cg_visit(Node &node, Node::value_function_t &val, frame_t &frame, task_t const &task, visit_t &next)
     {
-      // TODO: Determine body return type
-      node->result_type = Node::etype_t::function;
-      auto sub_context = std::make_shared<Context>(ctx);
-      val.owned_context = sub_context;
-      for (auto param : val.parameters)
-        cg_visit(param, sub_context, true);
-      cg_visit(val.body, sub_context, reg_vars);
+      if (frame.step == 0)
+      {
+        // TODO: Determine body return type
+        node.result_type = Node::etype_t::function;
+        // A function annotated by a worker gets its context from the worker
+        if (nullptr == val.owned_context)
+          val.owned_context = (task.session ? task.session->make<Context>(*task.session, frame.ctx) : frame.ctx->make_child());
+      }
+
+      auto sub_context = val.owned_context;
+      auto index = frame.step++;
+      if (index < val.parameters.size())
+      {
+        next = { val.parameters[index], sub_context, true };
+        return true;
+      }
+      if (index == val.parameters.size())
+      {
+        next = { val.body, sub_context, frame.reg_vars };
+        return true;
+      }
+
+      return false;
     }
 
-    void cg_visit_value_tuple(std::shared_ptr<Node> node, Node::value_tuple_t &val, std::shared_ptr<Context> ctx, bool reg_vars)
+    bool cg_visit(Node &node, Node::value_tuple_t &val, frame_t &frame, task_t const &, visit_t &next)
     {
-      node->result_type = Node::etype_t::tuple;
-      for (auto entry : val.entries)
-        cg_visit(entry, ctx, reg_vars);
+      node.result_type = Node::etype_t::tuple;
+      if (frame.step == val.entries.size())
+        return false;
+
+      next = { val.entries[frame.step++], frame.ctx, frame.reg_vars };
+      return true;
     }
     
-    void cg_visit_value_variable(std::shared_ptr<Node> node, Node::value_variable_t &val, std::shared_ptr<Context> ctx, bool reg_vars)
+    bool cg_visit(Node &node, Node::value_variable_t &val, frame_t &frame, task_t const &task, visit_t &)
     {
-      // Assumes that the first found instance is the correct one
+      auto ctx = frame.ctx;
+
+      // Assumes that the innermost declaration is the correct one
       // TODO: Enhance the type checking algorithm
-      auto possible_values = ctx->find(val.name);
-      val.record = possible_values.empty() ? nullptr : possible_values[0];
-      if (val.record.lock()) node->result_type = val.record.lock()->type;
-      if (!reg_vars) return;
-      if (!ctx->get(val.name).empty()) return;
-      val.record = ctx->add(ctx, val.name, node->result_type);
+      val.record = ctx->find(val.name);
+      if (val.record) node.result_type = (val.record == task.record ? task.type : val.record->type);
+      if (task.lookups && (nullptr == val.record || nullptr == val.record->context->parent))
+        task.lookups->push_back({ val.name, val.record });
+      if (!frame.reg_vars) return false;
+      if (nullptr != ctx->get(val.name)) return false;
+      if (is_reserved_symbol(val.name))
+      {
+        // TODO: Handle error properly
+        diagnostics(std::cerr) << ("Reserved word '" + std::string(builtin_symbols[val.name]) + "' can not be used as a parameter.\n");
+      }
+      val.record = ctx->add(val.name, node.result_type);
+      return false;
     }
 
-    void cg_visit_value_string(std::shared_ptr<Node> node, Node::value_string_t&, std::shared_ptr<Context>, bool)
-    { node->result_type = Node::etype_t::string; }
+    bool cg_visit(Node &node, Node::value_string_t &, frame_t &, task_t const &, visit_t &)
+    { node.result_type = Node::etype_t::string; return false; }
     
-    void cg_visit_value_character(std::shared_ptr<Node> node, Node::value_character_t&, std::shared_ptr<Context>, bool)
-    { node->result_type = Node::etype_t::character; }
+    bool cg_visit(Node &node, Node::value_character_t &, frame_t &, task_t const &, visit_t &)
+    { node.result_type = Node::etype_t::character; return false; }
 
-    void cg_visit_value_integer(std::shared_ptr<Node> node, Node::value_integer_t&, std::shared_ptr<Context>, bool)
-    { node->result_type = Node::etype_t::integer; }
+    bool cg_visit(Node &node, Node::value_integer_t &, frame_t &, task_t const &, visit_t &)
+    { node.result_type = Node::etype_t::integer; return false; }
     
-    void cg_visit_value_decimal(std::shared_ptr<Node> node, Node::value_decimal_t&, std::shared_ptr<Context>, bool)
-    { node->result_type = Node::etype_t::decimal; }
+    bool cg_visit(Node &node, Node::value_decimal_t &, frame_t &, task_t const &, visit_t &)
+    { node.result_type = Node::etype_t::decimal; return false; }
   }
 }
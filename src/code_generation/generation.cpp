@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "generation.hpp"
+
+
+namespace akbit::system::code_generation
+{
+  bool write_output(char const *path, std::vector<std::string> const &parts)
+  {
+    return write_output(path, std::vector<std::string_view>(parts.begin(), parts.end()));
+  }
+
+  bool write_output(char const *path, std::vector<std::string_view> const &parts)
+  {
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+      return false;
+
+    std::vector<iovec> pending;
+    pending.reserve(parts.size());
+    for (auto &part : parts)
+      if (!part.empty())
+        pending.push_back({ const_cast<char *>(part.data()), part.size() });
+
+    // A call takes at most IOV_MAX parts and may write only some of them
+    auto next = pending.begin();
+    while (next != pending.end())
+    {
+      auto count = static_cast<int>(std::min<std::size_t>(pending.end() - next, IOV_MAX));
+      ssize_t written = writev(fd, &*next, count);
+      if (written < 0)
+      {
+        if (errno == EINTR) continue;
+
+        int reason = errno;
+        close(fd);
+        errno = reason;
+        return false;
+      }
+
+      auto left = static_cast<std::size_t>(written);
+      while (next != pending.end() && left >= next->iov_len)
+        left -= (next++)->iov_len;
+      if (left > 0)
+      {
+        next->iov_base = static_cast<char *>(next->iov_base) + left;
+        next->iov_len -= left;
+      }
+    }
+
+    return 0 == close(fd);
+  }
+}
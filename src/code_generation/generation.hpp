@@ -3,7 +3,11 @@
 #ifndef AKBIT__SYSTEM__CODE_GENERATION__GENERATION_HPP
 #define AKBIT__SYSTEM__CODE_GENERATION__GENERATION_HPP
 
-#include "../node.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../flat_tree.hpp"
 #include "generators/javascript/generator.hpp"
 
 
@@ -14,11 +18,48 @@ namespace akbit::system::code_generation
     Javascript,
   };
 
-  inline std::string generate(std::shared_ptr<Node> node, GenerationTarget target, void* settings)
+  inline std::string generate(FlatTree const &tree, parsing::LiteralPool const &names, GenerationTarget target, void* settings)
+  {
+    switch (target)
+    {
+      case GenerationTarget::Javascript:
+      {
+        auto ags = ((nullptr == settings) ? js::Settings() : *((js::Settings*) settings));
+        return js::generate(tree, names, ags);
+      }
+    }
+    return {};
+  }
+
+  /// Text the code of a module starts with, before the code of its statements
+  inline std::string module_header(GenerationTarget target)
   {
-    auto ags = ((nullptr == settings) ? js::Settings() : *((js::Settings*) settings));
-    return js::generate(node, ags);
+    switch (target)
+    {
+      case GenerationTarget::Javascript: return js::module_header();
+    }
+    return {};
   }
+
+  /// Generates the code of a module on the threads of the pool
+  /// \return parts of the code to be written out one after another
+  inline std::vector<std::string> generate_parts(FlatTree const &tree, parsing::LiteralPool const &names, GenerationTarget target, void* settings, ThreadPool &pool)
+  {
+    switch (target)
+    {
+      case GenerationTarget::Javascript:
+      {
+        auto ags = ((nullptr == settings) ? js::Settings() : *((js::Settings*) settings));
+        return js::generate_parts(tree, names, ags, pool);
+      }
+    }
+    return {};
+  }
+
+  /// Writes the parts into the file in order, without joining them first
+  /// \return false if the file could not be written, errno describes the reason
+  bool write_output(char const *path, std::vector<std::string> const &parts);
+  bool write_output(char const *path, std::vector<std::string_view> const &parts);
 }
 
 #endif
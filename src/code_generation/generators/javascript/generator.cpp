@@ -1,187 +1,393 @@
-#include <memory>
-#include <type_traits>
-#include <variant>
 #include <string>
-#include <iostream>
-#include <fstream>
+#include <string_view>
+#include <vector>
 
 #include "generator.hpp"
+#include "../../../utf8.hpp"
+#include "../../../traversal.hpp"
+#include "../../../thread_pool.hpp"
 
 
 namespace akbit::system::code_generation::js
 {
   namespace
   {
-    template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
-    template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
-
-    // Context generation visitors
-    std::string cg_visit(std::shared_ptr<Node> node, Settings s);
-
-    std::string cg_visit_module(std::shared_ptr<Node> node, Node::module_t& val, Settings s);
-    std::string cg_visit_declaration(std::shared_ptr<Node> node, Node::declaration_t& val, Settings s);
-    std::string cg_visit_condition(std::shared_ptr<Node> node, Node::condition_t& val, Settings s);
-    std::string cg_visit_block(std::shared_ptr<Node> node, Node::block_t& val, Settings s);
-    std::string cg_visit_unary_operation(std::shared_ptr<Node> node, Node::unary_operation_t& val, Settings s);
-    std::string cg_visit_binary_operation(std::shared_ptr<Node> node, Node::binary_operation_t& val, Settings s);
-    std::string cg_visit_function_call(std::shared_ptr<Node> node, Node::function_call_t& val, Settings s);
-
-    std::string cg_visit_value_function(std::shared_ptr<Node> node, Node::value_function_t& val, Settings s);
-    std::string cg_visit_value_tuple(std::shared_ptr<Node> node, Node::value_tuple_t& val, Settings s);
-    std::string cg_visit_value_variable(std::shared_ptr<Node> node, Node::value_variable_t& val, Settings s);
-    std::string cg_visit_value_string(std::shared_ptr<Node> node, Node::value_string_t& val, Settings s);
-    std::string cg_visit_value_character(std::shared_ptr<Node> node, Node::value_character_t& val, Settings s);
-    std::string cg_visit_value_integer(std::shared_ptr<Node> node, Node::value_integer_t& val, Settings s);
-    std::string cg_visit_value_decimal(std::shared_ptr<Node> node, Node::value_decimal_t& val, Settings s);
+    /// Runtime support that every generated program starts with.
+    /// The build turns bootstrap.js into a string literal, so the compiler
+    /// does not depend on the directory it is started from
+    constexpr char bootstrap[] =
+#include "bootstrap.js.inc"
+    ;
+
+    /// Appends a JavaScript string literal with the given UTF-8 text
+    void quote(std::string_view text, std::string &literal)
+    {
+      static constexpr char digits[] = "0123456789abcdef";
+      literal += '"';
+
+      for (char c : text)
+      {
+        switch (c)
+        {
+          case '"':  literal += "\\\""; break;
+          case '\\': literal += "\\\\"; break;
+          case '\r': literal += "\\r"; break;
+          case '\n': literal += "\\n"; break;
+          case '\t': literal += "\\t"; break;
+          default:
+            if (static_cast<unsigned char>(c) < 0x20u)
+              (literal += "\\u00") += { digits[c >> 4], digits[c & 0xF] };
+            else
+              literal += c;
+        }
+      }
+
+      literal += '"';
+    }
+
+    using index_t = FlatTree::index_t;
+
+    /// What every visitor reads
+    struct Input
+    {
+      FlatTree const &tree;
+      parsing::LiteralPool const &names;
+    };
+
+    /// Part of the output that is still to be written
+    struct task_t
+    {
+      /// FlatTree::absent for text waiting on the stack of pending text
+      index_t node;
+      Settings settings;
+      /// Bytes of the text at the top of the pending stack
+      std::size_t length;
+    };
+
+    /// Code of a node: its own text and the children in between.
+    /// The children are generated after the visitor has returned,
+    /// so the depth of the tree is not limited by the native stack.
+    /// Text before the first child goes straight into the result, the rest
+    /// is kept in one buffer until the children before it are written
+    class Output
+    {
+    public:
+      explicit Output(std::string &result_)
+        : result(&result_)
+      { }
+
+    public:
+      inline void text(std::string_view value) { begin_text().append(value); end_text(); }
+      inline void spaces(std::size_t count) { begin_text().append(count, ' '); end_text(); }
+      inline void quoted(std::string_view value) { quote(value, begin_text()); end_text(); }
+
+      /// Absent children generate no code
+      inline void node(index_t node, Settings s)
+      {
+        if (FlatTree::absent != node)
+          parts.push_back({ node, s, 0 });
+      }
+
+      /// Moves the parts after the text already written onto the tasks,
+      /// the first one on top. Their text goes onto the pending stack
+      /// in the same order, so it is always at the top when its task is
+      void schedule(std::vector<task_t> &tasks, std::string &pending)
+      {
+        auto end = scratch.size();
+        for (auto part = parts.rbegin(); part != parts.rend(); ++part)
+        {
+          if (FlatTree::absent == part->node)
+          {
+            end -= part->length;
+            pending.append(scratch, end, part->length);
+          }
+          tasks.push_back(*part);
+        }
+
+        parts.clear();
+        scratch.clear();
+      }
+
+    private:
+      inline std::string & begin_text()
+      {
+        if (parts.empty())
+          return *result;
+
+        if (FlatTree::absent != parts.back().node)
+          parts.push_back({ FlatTree::absent, {}, 0 });
+        text_start = scratch.size() - parts.back().length;
+        return scratch;
+      }
+
+      inline void end_text()
+      {
+        if (!parts.empty())
+          parts.back().length = scratch.size() - text_start;
+      }
+
+    private:
+      std::string *result;
+      std::vector<task_t> parts;
+      /// Text of the parts, one after another
+      std::string scratch;
+      std::size_t text_start = 0;
+    };
+
+    // Code generation visitors
+    template <class T>
+    void cg_visit(Input const &, index_t, Settings, node_tag<T>, Output &out) { out.text("__UNKNOWN__"); }
+
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::module_t>, Output &out);
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::declaration_t>, Output &out);
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::condition_t>, Output &out);
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::block_t>, Output &out);
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::unary_operation_t>, Output &out);
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::binary_operation_t>, Output &out);
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::function_call_t>, Output &out);
+
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::value_function_t>, Output &out);
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::value_tuple_t>, Output &out);
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::value_variable_t>, Output &out);
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::value_string_t>, Output &out);
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::value_character_t>, Output &out);
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::value_integer_t>, Output &out);
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::value_decimal_t>, Output &out);
+
+    /// Appends the code of a subtree to `res`, nothing for an absent node
+    void emit(Input const &in, index_t root, Settings settings, std::string &res)
+    {
+      if (FlatTree::absent == root) return;
+
+      std::vector<task_t> tasks{ { root, settings, 0 } };
+      std::string pending;
+      Output out(res);
+
+      while (!tasks.empty())
+      {
+        auto task = tasks.back();
+        tasks.pop_back();
+
+        if (FlatTree::absent == task.node)
+        {
+          auto start = pending.size() - task.length;
+          res.append(pending, start, task.length);
+          pending.resize(start);
+          continue;
+        }
+
+        dispatch(in.tree.kinds[task.node], [&](auto kind) { cg_visit(in, task.node, task.settings, kind, out); });
+        out.schedule(tasks, pending);
+      }
+    }
   }
 
-  std::string generate(std::shared_ptr<Node> node, Settings settings)
+  std::string module_header()
   {
-    return cg_visit(node, settings);
+    return std::string("/* auto-generated code */\n") + bootstrap;
   }
 
-  namespace
+  std::string generate(FlatTree const &tree, parsing::LiteralPool const &names, Settings settings)
   {
-    std::string cg_visit(std::shared_ptr<Node> node, Settings s)
-    {
-      if (nullptr == node) return "";
-
-      return std::visit(overloaded {
-        [&](auto                     & ) -> std::string { return "__UNKNOWN__";                         },
-        [&](Node::module_t           &_) -> std::string { return cg_visit_module(node, _, s);           },
-        [&](Node::declaration_t      &_) -> std::string { return cg_visit_declaration(node, _, s);      },
-        [&](Node::condition_t        &_) -> std::string { return cg_visit_condition(node, _, s);        },
-        [&](Node::block_t            &_) -> std::string { return cg_visit_block(node, _, s);            },
-        [&](Node::unary_operation_t  &_) -> std::string { return cg_visit_unary_operation(node, _, s);  },
-        [&](Node::binary_operation_t &_) -> std::string { return cg_visit_binary_operation(node, _, s); },
-        [&](Node::function_call_t    &_) -> std::string { return cg_visit_function_call(node, _, s);    },
-        [&](Node::value_function_t   &_) -> std::string { return cg_visit_value_function(node, _, s);   },
-        [&](Node::value_tuple_t      &_) -> std::string { return cg_visit_value_tuple(node, _, s);      },
-        [&](Node::value_variable_t   &_) -> std::string { return cg_visit_value_variable(node, _, s);   },
-        [&](Node::value_string_t     &_) -> std::string { return cg_visit_value_string(node, _, s);     },
-        [&](Node::value_character_t  &_) -> std::string { return cg_visit_value_character(node, _, s);  },
-        [&](Node::value_integer_t    &_) -> std::string { return cg_visit_value_integer(node, _, s);    },
-        [&](Node::value_decimal_t    &_) -> std::string { return cg_visit_value_decimal(node, _, s);    },
-      }, node->value);
-    }
+    if (0 == tree.size()) return "";
 
-    std::string cg_visit_module(std::shared_ptr<Node>, Node::module_t &val, Settings s)
-    {
-      std::string res = "/* auto-generated code */\n";
+    std::string res;
+    emit({ tree, names }, 0, settings, res);
+    return res;
+  }
+
+  std::vector<std::string> generate_parts(FlatTree const &tree, parsing::LiteralPool const &names, Settings settings, ThreadPool &pool)
+  {
+    if (0 == tree.size() || tree.kinds[0] != Node::k_module)
+      return { generate(tree, names, settings) };
+
+    Input in{ tree, names };
+    auto statements = tree.children(0);
 
-      // TODO: Handle errors
-      std::fstream js_bootstrap_file;
-      // TODO: Place it somewhere else
-      js_bootstrap_file.open("src/code_generation/generators/javascript/bootstrap.js", std::ios::in);
-      if (js_bootstrap_file)
+    // Nodes are numbered in pre-order, so a statement ends where
+    // the next one starts and the last one ends with the tree
+    auto end_of = [&](std::size_t i) -> index_t {
+      for (++i; i < statements.size(); ++i)
+        if (FlatTree::absent != statements[i]) return statements[i];
+      return static_cast<index_t>(tree.size());
+    };
+
+    // Contiguous ranges of statements with about the same number of nodes,
+    // a few per thread so that an uneven range does not hold the others up
+    std::vector<std::size_t> bounds{ 0 };
+    auto target = tree.size() / (4 * pool.size()) + 1;
+    std::size_t nodes = 0;
+    for (std::size_t i = 0; i < statements.size(); ++i)
+    {
+      if (FlatTree::absent != statements[i])
+        nodes += end_of(i) - statements[i];
+      if (nodes >= target)
       {
-        std::string line;
-        while (std::getline(js_bootstrap_file, line))
-          res += line + '\n';
+        bounds.push_back(i + 1);
+        nodes = 0;
+      }
+    }
+    if (bounds.back() != statements.size())
+      bounds.push_back(statements.size());
 
-        js_bootstrap_file.close();
-      } else { std::cerr << "Failed to read the boostrap.js file!" << std::endl; }
+    // The first part is the text of the module itself
+    std::vector<std::string> parts(bounds.size());
+    parts[0] = module_header();
 
-      for (auto d : val.data)
-        res += cg_visit(d, s) + ";\n";
+    for (std::size_t r = 1; r < bounds.size(); ++r)
+    {
+      pool.submit([&, r](std::size_t) {
+        for (auto i = bounds[r - 1]; i < bounds[r]; ++i)
+        {
+          emit(in, statements[i], settings, parts[r]);
+          parts[r] += ";\n";
+        }
+      });
+    }
+    pool.wait();
 
-      return res;
+    return parts;
+  }
+
+  namespace
+  {
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::module_t>, Output &out)
+    {
+      out.text(module_header());
+      for (auto d : in.tree.children(node))
+      {
+        out.node(d, s);
+        out.text(";\n");
+      }
     }
 
-    std::string cg_visit_declaration(std::shared_ptr<Node>, Node::declaration_t &val, Settings s)
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::declaration_t>, Output &out)
     {
-      return std::string(s.indent, ' ') + "let u" + std::get<Node::value_variable_t>(val.variable->value).name + " = " + cg_visit(val.value, s);
+      auto parts = in.tree.children(node);
+      out.spaces(s.indent);
+      out.text("let u");
+      out.text(in.names.spelling(in.tree.variable(parts[0]).name));
+      out.text(" = ");
+      out.node(parts[2], s);
     }
 
-    std::string cg_visit_condition(std::shared_ptr<Node>, Node::condition_t &val, Settings s)
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::condition_t>, Output &out)
     {
-      return "(() => { if (" + cg_visit(val.expression, s)
-           + ") return " + cg_visit(val.clause_true, s) + "; else return "
-           + (val.clause_false ? cg_visit(val.clause_false, s) : std::string("null"))
-           + "; })()";
+      auto parts = in.tree.children(node);
+      out.text("(() => { if (");
+      out.node(parts[0], s);
+      out.text(") return ");
+      out.node(parts[1], s);
+      out.text("; else return ");
+      if (FlatTree::absent != parts[2]) out.node(parts[2], s);
+      else out.text("null");
+      out.text("; })()");
     }
 
-    std::string cg_visit_block(std::shared_ptr<Node>, Node::block_t &val, Settings s)
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::block_t>, Output &out)
     {
-      std::string res = "(() => {\n";
-      s.indent += 4;
-      for (auto& stmt : val.code)
+      out.text("(() => {\n");
+      auto inner = s;
+      inner.indent += 4;
+
+      auto code = in.tree.children(node);
+      for (auto& stmt : code)
       {
-        res += std::string(s.indent, ' ');
-        if (&stmt == &val.code.back()) res += "return ";
-        res += cg_visit(stmt, s) + ";\n";
+        out.spaces(inner.indent);
+        if (&stmt == &code.back()) out.text("return ");
+        out.node(stmt, inner);
+        out.text(";\n");
       }
-      res += std::string(s.indent - 4, ' ') + "})()";
-      return res;
+      out.spaces(s.indent);
+      out.text("})()");
     }
 
-    std::string cg_visit_unary_operation(std::shared_ptr<Node>, Node::unary_operation_t &val, Settings s)
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::unary_operation_t>, Output &out)
     {
-      return val.operation->representation + "(" + cg_visit(val.expression, s) + ")";
+      out.text(in.tree.operation(node).representation);
+      out.text("(");
+      out.node(in.tree.children(node)[0], s);
+      out.text(")");
     }
 
-    std::string cg_visit_binary_operation(std::shared_ptr<Node>, Node::binary_operation_t &val, Settings s)
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::binary_operation_t>, Output &out)
     {
-      std::string res = "so" + std::to_string(val.operation->id) + "(";
-      for (auto& p : val.operands)
+      out.text("so");
+      out.text(std::to_string(in.tree.operation(node).id));
+      out.text("(");
+      auto operands = in.tree.children(node);
+      for (auto& p : operands)
       {
-        if (&p != &val.operands.front()) res += ", ";
-        res += cg_visit(p, s);
+        if (&p != &operands.front()) out.text(", ");
+        out.node(p, s);
       }
-
-      return res + ")";
+      out.text(")");
     }
 
-    std::string cg_visit_function_call(std::shared_ptr<Node>, Node::function_call_t &val, Settings s)
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::function_call_t>, Output &out)
     {
-      std::string res = "(" + cg_visit(val.expression, s) + ")";
+      auto parts = in.tree.children(node);
+      out.text("(");
+      out.node(parts[0], s);
+      out.text(")");
       s.vectorise_tuple = false;
-      res += cg_visit(val.arguments, s);
-      return res;
+      out.node(parts[1], s);
     }
 
-    std::string cg_visit_value_function(std::shared_ptr<Node>, Node::value_function_t &val, Settings s)
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::value_function_t>, Output &out)
     {
-      std::string res = "((";
-      
-      for (auto& p : val.parameters)
+      out.text("((");
+
+      // The body follows the parameters
+      auto parts = in.tree.children(node);
+      auto parameters = parts.first(parts.size() - 1);
+      for (auto& p : parameters)
       {
-        if (&p != &val.parameters.front()) res += ", ";
-        res += cg_visit(std::get<Node::declaration_t>(p->value).variable, s);
+        if (&p != &parameters.front()) out.text(", ");
+        out.node(in.tree.children(p)[0], s);
       }
-      res += ") => " + cg_visit(val.body, s) + ")";
-
-      return res;
+      out.text(") => ");
+      out.node(parts.back(), s);
+      out.text(")");
     }
 
-    std::string cg_visit_value_tuple(std::shared_ptr<Node>, Node::value_tuple_t &val, Settings s)
+    void cg_visit(Input const &in, index_t node, Settings s, node_tag<Node::value_tuple_t>, Output &out)
     {
-      std::string res = s.vectorise_tuple ? "[" : "(";
+      out.text(s.vectorise_tuple ? "[" : "(");
+      auto closing = (s.vectorise_tuple ? "]" : ")");
       s.vectorise_tuple = true;
 
-      for (auto& p : val.entries)
+      auto entries = in.tree.children(node);
+      for (auto& p : entries)
       {
-        if (&p != &val.entries.front()) res += ", ";
-        res += cg_visit(p, s);
+        if (&p != &entries.front()) out.text(", ");
+        out.node(p, s);
       }
 
-      res += (res[0] == '[') ? ']' : ')';
-      return res;
+      out.text(closing);
     }
     
-    std::string cg_visit_value_variable(std::shared_ptr<Node>, Node::value_variable_t &val, Settings)
-    { return (val.record.lock() ? "u" : "s_") + val.name; }
+    void cg_visit(Input const &in, index_t node, Settings, node_tag<Node::value_variable_t>, Output &out)
+    {
+      auto &variable = in.tree.variable(node);
+      out.text(variable.record ? "u" : "s_");
+      out.text(in.names.spelling(variable.name));
+    }
 
-    std::string cg_visit_value_string(std::shared_ptr<Node>, Node::value_string_t& val, Settings)
-    { return val.value; }
+    void cg_visit(Input const &in, index_t node, Settings, node_tag<Node::value_string_t>, Output &out)
+    { out.quoted(in.tree.literal(node)); }
     
-    std::string cg_visit_value_character(std::shared_ptr<Node>, Node::value_character_t& val, Settings)
-    { return std::string(1, val.value); }
+    void cg_visit(Input const &in, index_t node, Settings, node_tag<Node::value_character_t>, Output &out)
+    {
+      std::string text;
+      encode_utf8(in.tree.payloads[node], text);
+      out.quoted(text);
+    }
 
-    std::string cg_visit_value_integer(std::shared_ptr<Node>, Node::value_integer_t& val, Settings)
-    { return val.value; }
+    void cg_visit(Input const &in, index_t node, Settings, node_tag<Node::value_integer_t>, Output &out)
+    { out.text(in.tree.literal(node)); }
     
-    std::string cg_visit_value_decimal(std::shared_ptr<Node>, Node::value_decimal_t& val, Settings)
-    { return val.value; }
+    void cg_visit(Input const &in, index_t node, Settings, node_tag<Node::value_decimal_t>, Output &out)
+    { out.text(in.tree.literal(node)); }
   }
 }
@@ -3,8 +3,17 @@
 #ifndef AKBIT__SYSTEM__CODE_GENERATION__JS_GENERATOR_HPP
 #define AKBIT__SYSTEM__CODE_GENERATION__JS_GENERATOR_HPP
 
-#include "../../../node.hpp"
+#include <string>
+#include <vector>
 
+#include "../../../flat_tree.hpp"
+#include "../../../parsing/literals.hpp"
+
+
+namespace akbit::system
+{
+  class ThreadPool;
+}
 
 namespace akbit::system::code_generation::js
 {
@@ -15,7 +24,18 @@ namespace akbit::system::code_generation::js
     bool vectorise_tuple = true;
   };
 
-  std::string generate(std::shared_ptr<Node> node, Settings settings);
+  /// Text the code of a module starts with,
+  /// the code of every statement follows it with ";\n" after each
+  std::string module_header();
+
+  /// \param tree annotated module
+  /// \param names pool the names of the module were interned in
+  std::string generate(FlatTree const &tree, parsing::LiteralPool const &names, Settings settings);
+
+  /// Generates the code of a module on the threads of the pool.
+  /// Every thread fills buffers of its own with ranges of the statements
+  /// \return parts of the code in order, together the same text `generate` returns
+  std::vector<std::string> generate_parts(FlatTree const &tree, parsing::LiteralPool const &names, Settings settings, ThreadPool &pool);
 }
 
 #endif
@@ -5,11 +5,14 @@
 
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
-#include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "node.hpp"
+#include "session.hpp"
+#include "symbols.hpp"
 
 
 namespace akbit::system
@@ -19,61 +22,102 @@ namespace akbit::system
 
   struct DeclarationRecord
   {
-    std::weak_ptr<Context> context;
-    std::string name;
+    Context * context;
+    symbol_t name;
     // TODO: Use dedicated type class instead
     Node::etype_t type;
   };
 
   struct Context
   {
+  public:
+    /// Number of declarations that a scope has when all of them are in scope
+    static constexpr std::size_t all = ~static_cast<std::size_t>(0);
+
   public:
     uint64_t const id;
-    std::weak_ptr<Context> parent;
-    std::vector<std::shared_ptr<DeclarationRecord>> declarations;
-  
-  private:
-    static uint64_t generate_next_id()
-    {
-      static uint64_t next_id = 0;
-      return ++next_id;
-    }
-    
+    Session &session;
+    Context * parent;
+    /// Number of the first declarations of the parent that are in scope here
+    std::size_t parent_visible;
+    std::vector<DeclarationRecord *> declarations;
+
   public:
-    Context(std::shared_ptr<Context> parent)
-      : id(generate_next_id())
-      , parent(parent)
+    /// \param session_ session the context and its declarations are allocated from,
+    ///                 it also numbers the contexts
+    /// \param parent_visible_ declarations of the parent that can be found from here,
+    ///                        for a scope made after the parent has got more of them
+    Context(Session &session_, Context * parent_, std::size_t parent_visible_ = all)
+      : id(session_.next_context_id())
+      , session(session_)
+      , parent(parent_)
+      , parent_visible(parent_visible_)
       , declarations{}
     { }
 
   public:
-    std::shared_ptr<DeclarationRecord> add(std::shared_ptr<Context> self, std::string& name, Node::etype_t type)
+    Context * make_child()
     {
-      return this->declarations.emplace_back(new DeclarationRecord{self, name, type});
+      return session.make<Context>(session, this);
     }
 
-    std::vector<std::shared_ptr<DeclarationRecord>> get(std::string& name) const
+    DeclarationRecord * add(symbol_t name, Node::etype_t type)
     {
-      std::vector<std::shared_ptr<DeclarationRecord>> results{};
-      std::copy_if(this->declarations.begin(), this->declarations.end(),
-                   std::back_inserter(results),
-                   [&](auto& record) { return record->name == name; });
-      return results;
+      auto record = this->declarations.emplace_back(session.make<DeclarationRecord>(this, name, type));
+      filter |= filter_bit(name);
+
+      // Small scopes are scanned, larger ones get an index.
+      // The first declaration of a name is the one that is found
+      if (!index.empty())
+        index.emplace(name, declarations.size() - 1);
+      else if (declarations.size() > linear_limit)
+        for (std::size_t i = 0; i < declarations.size(); ++i)
+          index.emplace(declarations[i]->name, i);
+
+      return record;
     }
 
-    std::vector<std::shared_ptr<DeclarationRecord>> find(std::string& name) const
+    /// \param visible number of the first declarations to look at
+    /// \return first declaration of the name in this scope or nullptr
+    DeclarationRecord * get(symbol_t name, std::size_t visible = all) const
     {
-      std::vector<std::shared_ptr<DeclarationRecord>> results{};
-      std::copy_if(this->declarations.begin(), this->declarations.end(),
-                   std::back_inserter(results),
-                   [&](auto& record) { return record->name == name; });
-      if (!this->parent.lock()) return results;
-
-      auto rest = this->parent.lock()->find(name);
-      results.reserve(results.size() + rest.size());
-      results.insert(results.end(), rest.begin(), rest.end());
-      return results;
+      if (!(filter & filter_bit(name))) return nullptr;
+
+      if (!index.empty())
+      {
+        auto found = index.find(name);
+        return (found != index.end() && found->second < visible ? declarations[found->second] : nullptr);
+      }
+
+      visible = std::min(visible, declarations.size());
+      for (std::size_t i = 0; i < visible; ++i)
+        if (declarations[i]->name == name) return declarations[i];
+      return nullptr;
     }
+
+    /// \return declaration of the name in the innermost scope that has one, or nullptr
+    DeclarationRecord * find(symbol_t name) const
+    {
+      auto visible = all;
+      for (auto scope = this; nullptr != scope; visible = scope->parent_visible, scope = scope->parent)
+        if (auto record = scope->get(name, visible))
+          return record;
+      return nullptr;
+    }
+
+  private:
+    static constexpr std::size_t linear_limit = 8;
+
+    /// One bit of the filter per name, a clear bit means that
+    /// the scope surely has no declaration of the name
+    static constexpr std::uint64_t filter_bit(symbol_t name) noexcept
+    {
+      return static_cast<std::uint64_t>(1) << ((name * 0x9E3779B1u) >> 26);
+    }
+
+    std::uint64_t filter = 0;
+    /// Position of the first declaration of every name
+    std::unordered_map<symbol_t, std::size_t> index;
   };
 }
 
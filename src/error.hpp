@@ -20,6 +20,8 @@ namespace akbit::system::parsing
     // Tokenization
     t_unexpected_eof = 1010,
 
+    t_invalid_utf8 = 1015,
+
     t_invalid_identifier = 1020,
 
     t_special_character_does_not_exist = 1030,
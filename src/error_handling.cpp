@@ -1,35 +1,66 @@
 #include <iostream>
+#include <utility>
 
 #include "error_handling.hpp"
+#include "source.hpp"
 #include "parsing/lexing.hpp"
 #include "parsing/parsing.hpp"
 
 
 namespace akbit::system
 {
-  template <typename T>
-  static inline void log_error_common(T state)
+  namespace
   {
-    std::cout << "Error #LC" << static_cast<int>(state.error.code) << ":\n";
-    std::cout << state.error.message << "\n\n";
+    thread_local std::ostream * captured = nullptr;
   }
 
+  std::ostream * capture_diagnostics(std::ostream * out) noexcept
+  {
+    std::swap(captured, out);
+    return out;
+  }
+
+  std::ostream & diagnostics(std::ostream &standard) noexcept
+  {
+    return (nullptr != captured ? *captured : standard);
+  }
+
+
   void log_error(parsing::LexerState &state)
   {
-    log_error_common(state);
+    auto &out = diagnostics(std::cout);
+    out << "Error #LC" << static_cast<int>(state.error.code) << ":\n";
+    out << state.error.message << "\n\n";
 
-    std::cout << "Line: " << state.line << "\n";
-    std::cout << "Column: " << state.column << "\n\n";
+    auto position = LineTable(state.source).locate(state.index);
+    out << "Line: " << position.line << "\n";
+    out << "Column: " << position.column << "\n\n";
 
     // throw std::runtime_error("halt");
   }
 
   void log_error(parsing::ParserState &state)
   {
-    log_error_common(state);
+    using parsing::TokenSubType;
+    using parsing::TokenType;
+
+    auto const &error = state.error;
+    auto const &token = state.tokens.at(error.token);
+
+    std::string expected = (error.expected_sub_type != TokenSubType::t_unknown
+      ? parsing::get_sub_type_name(error.expected_sub_type)
+      : error.expected_type != TokenType::t_unknown
+        ? parsing::get_type_name(error.expected_type)
+        : "value");
+
+    auto &out = diagnostics(std::cout);
+    out << "Error #LC" << static_cast<int>(error.code) << ":\n";
+    out << "<" << expected << "> expected, but <"
+      << parsing::get_sub_type_name(token.sub_type) << ">(" << token.value << ") was given\n\n";
 
-    std::cout << "Line: " << state.peek().line << "\n";
-    std::cout << "Column: " << state.peek().column << "\n\n";
+    auto position = LineTable(state.source).locate(token.index);
+    out << "Line: " << position.line << "\n";
+    out << "Column: " << position.column << "\n\n";
     // TODO: Implement specific error handling stuff
     // TODO: Implement specific error handling stuff
     // TODO: Implement specific error handling stuff
@@ -2,6 +2,8 @@
 #ifndef AKBIT__SYSTEM__ERROR_HANDLING_HPP
 #define AKBIT__SYSTEM__ERROR_HANDLING_HPP
 
+#include <iosfwd>
+
 namespace akbit::system
 {
   namespace parsing
@@ -12,6 +14,15 @@ namespace akbit::system
 
   void log_error(parsing::LexerState &state);
   void log_error(parsing::ParserState &state);
+
+  /// Sends the diagnostics of the calling thread to `out`,
+  /// nullptr sends them back to the standard streams
+  /// \return where they were sent before
+  std::ostream * capture_diagnostics(std::ostream * out) noexcept;
+
+  /// \param standard stream the diagnostics go to unless they are captured
+  /// \return stream to write a diagnostic of the calling thread to
+  std::ostream & diagnostics(std::ostream &standard) noexcept;
 }
 
 #endif
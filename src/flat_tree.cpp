@@ -0,0 +1,114 @@
+#include <utility>
+
+#include "flat_tree.hpp"
+
+
+namespace akbit::system
+{
+  FlatTree::FlatTree(Node const * root)
+  {
+    FlatTreeBuilder builder;
+    walk(root,
+      [&](Node const * node, std::size_t) { builder.enter(node); },
+      [&](Node const * node) { builder.leave(node); });
+    *this = builder.take();
+  }
+
+  void FlatTreeBuilder::enter(Node const * node)
+  {
+    using index_t = FlatTree::index_t;
+
+    auto index = (nullptr == node ? FlatTree::absent : static_cast<index_t>(tree.kinds.size()));
+    if (!cursors.empty())
+      tree.links[cursors.back()++] = index;
+    if (nullptr == node) return;
+
+    tree.kinds.push_back(node->kind());
+    tree.result_types.push_back(node->result_type);
+    tree.offsets.push_back(static_cast<index_t>(tree.links.size()));
+
+    auto payload = dispatch(*node, overloaded {
+      [ ](Node const &, auto const &                        ) -> index_t { return 0; },
+      [ ](Node const &, Node::module_t const &value          ) -> index_t { return value.has_errors; },
+      [ ](Node const &, Node::binary_operation_t const &value) -> index_t { return value.operation->id; },
+      [ ](Node const &, Node::unary_operation_t const &value ) -> index_t { return value.operation->id; },
+      [ ](Node const &, Node::value_character_t const &value ) -> index_t { return value.value; },
+      [&](Node const &, Node::value_string_t const &value    ) -> index_t { return tree.add_literal(value.value); },
+      [&](Node const &, Node::value_integer_t const &value   ) -> index_t { return tree.add_literal(value.value); },
+      [&](Node const &, Node::value_decimal_t const &value   ) -> index_t { return tree.add_literal(value.value); },
+      [&](Node const &, Node::value_variable_t const &value  ) -> index_t {
+        tree.variables.push_back({ value.name, value.record });
+        return static_cast<index_t>(tree.variables.size() - 1);
+      },
+    });
+    tree.payloads.push_back(payload);
+
+    // Slots for the children are reserved before they are entered,
+    // so that the links of one node stay next to each other
+    index_t count = 0;
+    for_each_child(*node, [&](Node const *) { ++count; });
+
+    cursors.push_back(tree.links.size());
+    tree.links.resize(tree.links.size() + count);
+  }
+
+  void FlatTreeBuilder::leave(Node const * node)
+  {
+    if (nullptr != node)
+      cursors.pop_back();
+  }
+
+  FlatTree FlatTreeBuilder::take()
+  {
+    if (!tree.kinds.empty())
+      tree.offsets.push_back(static_cast<FlatTree::index_t>(tree.links.size()));
+
+    cursors.clear();
+    return std::exchange(tree, FlatTree());
+  }
+
+  FlatTree::index_t FlatTree::add_literal(std::string const &text)
+  {
+    literals.push_back(text);
+    return static_cast<index_t>(literals.size() - 1);
+  }
+
+  std::size_t FlatTree::bytes() const noexcept
+  {
+    std::size_t total = kinds.capacity() * sizeof(kind_t)
+                      + result_types.capacity() * sizeof(Node::etype_t)
+                      + payloads.capacity() * sizeof(index_t)
+                      + offsets.capacity() * sizeof(index_t)
+                      + links.capacity() * sizeof(index_t)
+                      + literals.capacity() * sizeof(std::string)
+                      + variables.capacity() * sizeof(variable_t);
+
+    for (auto &literal : literals)
+      total += heap_bytes(literal);
+
+    return total;
+  }
+
+  std::size_t tree_bytes(Node const * root)
+  {
+    auto children = [](std::vector<Node *> const &nodes) { return nodes.capacity() * sizeof(Node *); };
+
+    std::size_t total = 0;
+    walk(root, [&](Node const * node, std::size_t) {
+      if (nullptr == node) return;
+      total += sizeof(Node) + dispatch(*node, overloaded {
+        [&](Node const &, auto const &                        ) -> std::size_t { return 0; },
+        [&](Node const &, Node::module_t const &value          ) -> std::size_t { return children(value.data); },
+        [&](Node const &, Node::block_t const &value           ) -> std::size_t { return children(value.code); },
+        [&](Node const &, Node::binary_operation_t const &value) -> std::size_t { return children(value.operands); },
+        [&](Node const &, Node::value_function_t const &value  ) -> std::size_t { return children(value.parameters); },
+        [&](Node const &, Node::value_tuple_t const &value     ) -> std::size_t { return children(value.entries); },
+        [&](Node const &, Node::value_string_t const &value    ) -> std::size_t { return heap_bytes(value.value); },
+        [&](Node const &, Node::value_integer_t const &value   ) -> std::size_t { return heap_bytes(value.value); },
+        [&](Node const &, Node::value_decimal_t const &value   ) -> std::size_t { return heap_bytes(value.value); },
+      });
+    }, [](Node const *) { });
+
+    return total;
+  }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__FLAT_TREE_HPP
+#define AKBIT__SYSTEM__FLAT_TREE_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "node.hpp"
+#include "operators.hpp"
+#include "symbols.hpp"
+#include "traversal.hpp"
+
+
+namespace akbit::system
+{
+  /// \return bytes a string keeps outside of itself, 0 if the text fits inline
+  inline std::size_t heap_bytes(std::string const &text) noexcept
+  {
+    auto begin = reinterpret_cast<char const *>(&text);
+    auto inline_text = (text.data() >= begin && text.data() < begin + sizeof(std::string));
+    return (inline_text ? 0 : text.capacity() + 1);
+  }
+
+  /// Bytes used by a tree of nodes: the nodes themselves,
+  /// the arrays of their children and their text
+  std::size_t tree_bytes(Node const * root);
+
+
+  /// Read-only copy of an annotated tree stored as parallel arrays.
+  /// Nodes are numbered in pre-order, so a walk from the root reads every
+  /// array front to back; the children of a node are contiguous in `links`
+  struct FlatTree
+  {
+  public:
+    using index_t = std::uint32_t;
+
+    /// Link of an optional child that is not present
+    static constexpr index_t absent = ~static_cast<index_t>(0);
+
+    using kind_t = Node::kind_t;
+
+    struct variable_t
+    {
+      symbol_t name;
+      DeclarationRecord * record;
+    };
+
+  public:
+    std::vector<kind_t> kinds;
+    std::vector<Node::etype_t> result_types;
+
+    /// Meaning depends on the kind: index in `literals` for strings and
+    /// numbers, index in `variables` for variables, the code point of a
+    /// character, the id of an operator and 1 for a module with errors
+    std::vector<index_t> payloads;
+
+    /// Children of node `i` are `links[offsets[i]]` up to `links[offsets[i + 1]]`
+    std::vector<index_t> offsets;
+    std::vector<index_t> links;
+
+    std::vector<std::string> literals;
+    std::vector<variable_t> variables;
+
+  public:
+    /// \param root annotated tree, nullptr gives an empty flat tree
+    explicit FlatTree(Node const * root);
+    FlatTree() = default;
+
+  public:
+    inline std::size_t size() const noexcept { return kinds.size(); }
+
+    inline std::span<index_t const> children(index_t node) const noexcept
+    {
+      return { links.data() + offsets[node], offsets[node + 1] - offsets[node] };
+    }
+
+    inline operator_t const & operation(index_t node) const noexcept { return operators_list[payloads[node]]; }
+    inline std::string const & literal(index_t node) const noexcept { return literals[payloads[node]]; }
+    inline variable_t const & variable(index_t node) const noexcept { return variables[payloads[node]]; }
+
+    /// \return bytes used by the arrays and by the literals stored outside of them
+    std::size_t bytes() const noexcept;
+
+  private:
+    index_t add_literal(std::string const &text);
+
+    friend class FlatTreeBuilder;
+  };
+
+
+  /// Copies the nodes of an annotated tree into a FlatTree
+  /// while they are walked in pre-order, one node at a time
+  class FlatTreeBuilder
+  {
+  public:
+    /// \param node nullptr for an optional child that is absent
+    void enter(Node const * node);
+    void leave(Node const * node);
+
+    /// \return the tree of the nodes entered so far, the builder is left empty
+    FlatTree take();
+
+  private:
+    FlatTree tree;
+    /// Next link to fill for every node that is entered and not left yet
+    std::vector<std::size_t> cursors;
+  };
+}
+
+#endif
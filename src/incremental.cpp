@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+#include "incremental.hpp"
+#include "annotation.hpp"
+#include "context.hpp"
+#include "error_handling.hpp"
+#include "flat_tree.hpp"
+#include "session.hpp"
+#include "parsing/lexing.hpp"
+#include "parsing/parsing.hpp"
+#include "parsing/token_stream.hpp"
+#include "code_generation/generation.hpp"
+
+
+namespace akbit::system
+{
+  bool IncrementalCompiler::compile(SourceBuffer const &source, char const *output)
+  {
+    using code_generation::GenerationTarget;
+
+    parsing::LexerState lexer(source.text(), literals);
+    if (!parsing::validate_source(lexer))
+    {
+      log_error(lexer);
+      return false;
+    }
+    parsing::TokenStream tokens(lexer);
+
+    // Equal statements of the previous compilation are taken in their order
+    std::unordered_map<std::uint64_t, std::vector<std::size_t>> previous;
+    for (auto i = statements.size(); i --> 0;)
+      previous[statements[i].fingerprint].push_back(i);
+
+    // Global declarations live in the session of the compilation,
+    // everything else of a statement lives in a session of its own
+    Session session;
+    auto global = session.make<Context>(session, nullptr);
+    Session statement_session;
+    parsing::StatementParser parser(tokens, source.text(), statement_session, true);
+
+    // Reused statements are moved out of the previous compilation,
+    // they are put back if this one fails
+    std::vector<statement_t> compiled;
+    std::vector<std::pair<std::size_t, std::size_t>> taken;
+    report_t report;
+    std::vector<annotation::global_lookup_t> lookups;
+    for (Node * node; parser.next(node); statement_session.reset())
+    {
+      // Nothing is compiled from a statement with a syntax error
+      if (parser.is_failed())
+        break;
+
+      ++report.statements;
+      auto earlier = previous.find(parser.fingerprint());
+      bool unchanged = (earlier != previous.end() && !earlier->second.empty());
+
+      if (unchanged)
+      {
+        auto index = earlier->second.back();
+        auto &statement = statements[index];
+        earlier->second.pop_back();
+
+        if (resolves_as_before(statement, *global))
+        {
+          for (auto &[name, type] : statement.declarations)
+            global->add(name, type);
+          taken.push_back({ index, compiled.size() });
+          compiled.push_back(std::move(statement));
+          ++report.reused;
+
+          literals.release_before(parser.lookahead());
+          continue;
+        }
+      }
+      ++(unchanged ? report.dependents : report.changed);
+
+      auto first = global->declarations.size();
+      lookups.clear();
+      annotation::generate_context(node, global, statement_session, &lookups);
+
+      statement_t statement{ parser.fingerprint(), {}, {}, {} };
+      auto own = global->declarations.begin() + first;
+      for (auto record = own; record != global->declarations.end(); ++record)
+        statement.declarations.push_back({ (*record)->name, (*record)->type });
+
+      // A name that resolves to a declaration of the statement itself
+      // depends on no earlier statement declaring it
+      for (auto &lookup : lookups)
+      {
+        bool declared = (nullptr != lookup.record && std::find(own, global->declarations.end(), lookup.record) == global->declarations.end());
+        statement.dependencies.push_back({ lookup.name, declared, (declared ? lookup.record->type : Node::etype_t::unknown) });
+      }
+      auto by_name = [](dependency_t const &a, dependency_t const &b) { return a.name < b.name; };
+      auto same_name = [](dependency_t const &a, dependency_t const &b) { return a.name == b.name; };
+      std::stable_sort(statement.dependencies.begin(), statement.dependencies.end(), by_name);
+      statement.dependencies.erase(std::unique(statement.dependencies.begin(), statement.dependencies.end(), same_name), statement.dependencies.end());
+
+      FlatTree flat(node);
+      statement.code = code_generation::generate(flat, literals, GenerationTarget::Javascript, nullptr) + ";\n";
+      compiled.push_back(std::move(statement));
+
+      literals.release_before(parser.lookahead());
+    }
+
+    // A lexical error is known once the tokens have ended
+    if (parser.is_failed())
+    {
+      for (auto [from, to] : taken)
+        statements[from] = std::move(compiled[to]);
+      return false;
+    }
+
+    statements = std::move(compiled);
+    last_report = report;
+
+    auto header = code_generation::module_header(GenerationTarget::Javascript);
+    std::vector<std::string_view> parts{ header };
+    for (auto &statement : statements)
+      parts.push_back(statement.code);
+    return code_generation::write_output(output, parts);
+  }
+
+  bool IncrementalCompiler::resolves_as_before(statement_t const &statement, Context const &global)
+  {
+    for (auto &dependency : statement.dependencies)
+    {
+      auto record = global.get(dependency.name);
+      if ((nullptr != record) != dependency.declared) return false;
+      if (nullptr != record && record->type != dependency.type) return false;
+    }
+    return true;
+  }
+}
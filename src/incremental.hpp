@@ -0,0 +1,97 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__INCREMENTAL_HPP
+#define AKBIT__SYSTEM__INCREMENTAL_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "node.hpp"
+#include "source.hpp"
+#include "symbols.hpp"
+#include "parsing/literals.hpp"
+
+
+namespace akbit::system
+{
+  struct Context;
+
+  /// Compiles one module again every time it changes.
+  /// The top-level statements are matched with the ones of the previous
+  /// compilation by a fingerprint of their tokens. A statement that has not
+  /// changed and whose global names still resolve to declarations of the same
+  /// types is not annotated again: its declarations are added back from the
+  /// ones it made before and its code is reused. Everything else is annotated
+  /// and generated one statement at a time, as by a streaming compilation
+  class IncrementalCompiler
+  {
+  public:
+    /// What a compilation has done with the statements of the module
+    struct report_t
+    {
+      std::size_t statements = 0;
+      /// Statements that are new or whose tokens have changed
+      std::size_t changed = 0;
+      /// Unchanged statements annotated again, as a declaration they use has changed
+      std::size_t dependents = 0;
+      std::size_t reused = 0;
+    };
+
+  public:
+    IncrementalCompiler() = default;
+    IncrementalCompiler(IncrementalCompiler const &) = delete;
+    IncrementalCompiler &operator =(IncrementalCompiler const &) = delete;
+
+  public:
+    /// Compiles the source into a JavaScript file, the same one that a full
+    /// compilation writes. Diagnostics are printed for the statements that
+    /// are annotated, not for the reused ones
+    /// \return false if the source is not valid or has errors, then nothing
+    ///         is kept from it and the file is left as it is, or if the file
+    ///         could not be written, errno describes the reason
+    bool compile(SourceBuffer const &source, char const *output);
+
+    inline report_t const & report() const noexcept { return last_report; }
+
+  private:
+    /// Global name that a statement uses, an edge of the dependency graph
+    /// from the statement to the earlier one that declares the name
+    struct dependency_t
+    {
+      symbol_t name;
+      /// Whether an earlier statement declares the name
+      bool declared;
+      /// Type of the declaration the name resolved to
+      Node::etype_t type;
+    };
+
+    struct statement_t
+    {
+      std::uint64_t fingerprint;
+      /// Generated code of the statement, with the separator after it
+      std::string code;
+      /// Global declarations that the statement makes, in their order
+      std::vector<std::pair<symbol_t, Node::etype_t>> declarations;
+      /// Sorted by name, one per name
+      std::vector<dependency_t> dependencies;
+    };
+
+  private:
+    /// \return whether every global name of the statement resolves
+    ///         in the same way as when it was annotated
+    static bool resolves_as_before(statement_t const &statement, Context const &global);
+
+  private:
+    /// Names are interned once for all compilations, so that the symbols
+    /// kept in the statements can be compared with new ones
+    parsing::LiteralPool literals;
+    std::vector<statement_t> statements;
+    report_t last_report;
+  };
+}
+
+#endif
@@ -1,262 +1,986 @@
 #include <memory>
 #include <string>
 #include <string.h>
-#include <type_traits>
-#include <variant>
 #include <vector>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <chrono>
 #include <cerrno>
-
-
+#include <optional>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <semaphore>
+#include <set>
+#include <sstream>
+#include <thread>
+
+
+#include "source.hpp"
+#include "utf8.hpp"
+#include "error_handling.hpp"
 #include "parsing/lexing.hpp"
 #include "parsing/parsing.hpp"
 #include "annotation.hpp"
 #include "node.hpp"
 #include "context.hpp"
+#include "session.hpp"
+#include "flat_tree.hpp"
+#include "traversal.hpp"
+#include "pipeline.hpp"
+#include "thread_pool.hpp"
+#include "incremental.hpp"
 #include "code_generation/generation.hpp"
 #include "code_generation/generators/javascript/generator.hpp"
 
 
 namespace
 {
-  template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
-  template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
-
-
   std::string get_node_type_name(akbit::system::Node const & node)
   {
     using sn = akbit::system::Node;
-    return std::visit(overloaded {
-      [](auto                  &) -> std::string { return "#???";             },
-      [](sn::module_t           ) -> std::string { return "module";           },
-      [](sn::declaration_t      ) -> std::string { return "declaration";      },
-      [](sn::condition_t        ) -> std::string { return "condition";        },
-      [](sn::binary_operation_t ) -> std::string { return "operation-binary"; },
-      [](sn::unary_operation_t  ) -> std::string { return "operation-unary";  },
-      [](sn::function_call_t    ) -> std::string { return "call";             },
-      [](sn::block_t            ) -> std::string { return "block";            },
-      [](sn::value_function_t   ) -> std::string { return "function";         },
-      [](sn::value_tuple_t      ) -> std::string { return "tuple";            },
-      [](sn::value_variable_t   ) -> std::string { return "variable";         },
-      [](sn::value_string_t     ) -> std::string { return "string";           },
-      [](sn::value_character_t  ) -> std::string { return "character";        },
-      [](sn::value_integer_t    ) -> std::string { return "integer";          },
-      [](sn::value_decimal_t    ) -> std::string { return "decimal";          },
-    }, node.value);
+    using akbit::system::node_tag;
+    return akbit::system::dispatch(node.kind(), akbit::system::overloaded {
+      [](auto                              ) -> std::string { return "#???";             },
+      [](node_tag<sn::module_t>            ) -> std::string { return "module";           },
+      [](node_tag<sn::declaration_t>       ) -> std::string { return "declaration";      },
+      [](node_tag<sn::condition_t>         ) -> std::string { return "condition";        },
+      [](node_tag<sn::binary_operation_t>  ) -> std::string { return "operation-binary"; },
+      [](node_tag<sn::unary_operation_t>   ) -> std::string { return "operation-unary";  },
+      [](node_tag<sn::function_call_t>     ) -> std::string { return "call";             },
+      [](node_tag<sn::block_t>             ) -> std::string { return "block";            },
+      [](node_tag<sn::value_function_t>    ) -> std::string { return "function";         },
+      [](node_tag<sn::value_tuple_t>       ) -> std::string { return "tuple";            },
+      [](node_tag<sn::value_variable_t>    ) -> std::string { return "variable";         },
+      [](node_tag<sn::value_string_t>      ) -> std::string { return "string";           },
+      [](node_tag<sn::value_character_t>   ) -> std::string { return "character";        },
+      [](node_tag<sn::value_integer_t>     ) -> std::string { return "integer";          },
+      [](node_tag<sn::value_decimal_t>     ) -> std::string { return "decimal";          },
+    });
   }
 
-  void draw_p(std::uint32_t depth, std::uint64_t mask)
+  /// \param ended columns whose branch has no more nodes, drawn as spaces
+  void draw_p(std::uint32_t depth, std::vector<bool> const &ended)
   {
     if (depth == ~(static_cast<std::uint32_t>(0)))
       return;
 
+    auto is_ended = [&](std::uint32_t column) { return column < ended.size() && ended[column]; };
+
     std::wcout << L"\x1b[32m";
     for (std::uint32_t i = 0; i < depth; ++i)
     {
-      if (mask & (static_cast<std::uint64_t>(1) << i))
+      if (is_ended(i))
         std::cout << "\x20\x20\x20";
       else
         std::cout << "\u2502\x20\x20";
     }
 
-    if (mask & (static_cast<std::uint64_t>(1) << depth))
+    if (is_ended(depth))
       std::cout << "\u2514\u2500 ";
     else
       std::cout << "\u251C\u2500 ";
 
     std::wcout << L"\x1b[37m";
   }
-}
 
-void dump_ast(std::shared_ptr<akbit::system::Node> node_, std::uint32_t depth, std::uint64_t mask)
-{
-  using akbit::system::Node;
 
-  std::cout << '\n';
-  draw_p(depth, mask);
-  ++depth;
+  /// Reports how much memory both forms of the tree take and how long
+  /// a pass that reads the kind and the annotation of every node takes
+  /// on each of them: a walk of the pointers against a scan of the arrays
+  void print_ast_stats(akbit::system::Node const * ast, akbit::system::FlatTree const &flat)
+  {
+    using akbit::system::Node;
+    using clock = std::chrono::steady_clock;
+
+    auto nodes = flat.size();
+    if (0 == nodes) return;
+
+    auto walk_tree = [&] {
+      std::size_t sum = 0;
+      akbit::system::walk(ast, [&](Node const * node, std::size_t) {
+        if (nullptr != node) sum += static_cast<std::size_t>(node->kind()) + static_cast<std::size_t>(node->result_type);
+      }, [](Node const *) { });
+      return sum;
+    };
+
+    // Nodes are stored in pre-order, so visiting all of them is a scan
+    // of the arrays front to back with no links followed
+    auto walk_flat = [&] {
+      std::size_t sum = 0;
+      for (std::size_t node = 0; node < nodes; ++node)
+        sum += static_cast<std::size_t>(flat.kinds[node]) + static_cast<std::size_t>(flat.result_types[node]);
+      return sum;
+    };
+
+    // Best of several runs, the first one also warms the caches up
+    auto measure = [](auto &&walk, std::size_t &sum) {
+      auto best = clock::duration::max();
+      for (int run = 0; run < 5; ++run)
+      {
+        auto start = clock::now();
+        sum = walk();
+        best = std::min(best, clock::now() - start);
+      }
+      return std::chrono::duration<double, std::micro>(best).count();
+    };
+
+    std::size_t tree_sum = 0, flat_sum = 0;
+    auto tree_time = measure(walk_tree, tree_sum);
+    auto flat_time = measure(walk_flat, flat_sum);
+
+    std::cerr << std::dec << std::fixed << std::setprecision(1)
+      << "AST statistics: " << nodes << " nodes\n"
+      << "  tree: " << static_cast<double>(akbit::system::tree_bytes(ast)) / nodes << " bytes/node, "
+      << "walk " << tree_time << " us\n"
+      << "  flat: " << static_cast<double>(flat.bytes()) / nodes << " bytes/node, "
+      << "walk " << flat_time << " us"
+      << (tree_sum == flat_sum ? "" : " (the trees differ)") << std::endl;
+  }
+
+
+  /// Prints the annotated tree to the standard output
+  class AstDump final : public akbit::system::NodePass
+  {
+  public:
+    explicit AstDump(akbit::system::parsing::LiteralPool const &names_)
+      : names(names_)
+    { }
+
+    void enter(akbit::system::Node const * node, std::size_t slot) override;
+    void leave(akbit::system::Node const * node) override;
+    void finish() override;
+
+  private:
+    struct frame_t
+    {
+      akbit::system::Node const * node;
+      /// Depth of the lines of the node
+      std::uint32_t depth;
+      /// Column the node has ended for the lines below it, ~0 if none,
+      /// and whether it was ended before
+      std::uint32_t column;
+      bool was_ended;
+    };
+
+    /// \return whether the column was ended before
+    bool end_column(std::uint32_t column);
+    void restore_column(std::uint32_t column, bool was_ended);
+
+    akbit::system::parsing::LiteralPool const &names;
+    akbit::system::Node const * root = nullptr;
+    /// Nodes that are entered and not left yet
+    std::vector<frame_t> frames;
+    /// Columns of the tree drawing that have no more branches,
+    /// one per level of nesting rather than a fixed number of bits
+    std::vector<bool> ended;
+  };
+
+  bool AstDump::end_column(std::uint32_t column)
+  {
+    if (column >= ended.size())
+      ended.resize(column + 1, false);
+
+    bool was_ended = ended[column];
+    ended[column] = true;
+    return was_ended;
+  }
 
-  if (nullptr == node_)
+  void AstDump::restore_column(std::uint32_t column, bool was_ended)
   {
-    std::cout << "\x1b[44mVOID*\x1b[49m";
-    return;
+    if (column != ~static_cast<std::uint32_t>(0))
+      ended[column] = was_ended;
   }
 
-  auto &node = *node_;
-  std::cout << get_node_type_name(node) << ": ";
-
-  std::visit(overloaded {
-    [&](auto&) { std::cout << "\x1b[44mUNKNOWN*\x1b[49m"; },
-    
-    [&](Node::module_t           &node) {
-      for (std::size_t i = 0; i < node.data.size(); ++i)
-        dump_ast(node.data[i], depth, mask);
-    },
-
-    [&](Node::declaration_t      &node) {
-      std::cout << '\n';
-      draw_p(depth, mask);
-      std::cout << "variable: ";
-      // std::cout << "\x1b[97m";
-      dump_ast(node.variable, depth + 1u, mask);
-
-      std::cout << '\n';
-      draw_p(depth, mask);
-      std::cout << "type: ";
-      // std::cout << "\x1b[97m";
-      dump_ast(node.type, depth + 1u, mask);
-
-      dump_ast(node.value, depth, mask);
-    },
-
-    [&](Node::condition_t        &node) {
-      std::cout << '\n';
-      draw_p(depth, mask);
-      std::cout << "expression: ";
-      std::cout << "\x1b[97m";
-      dump_ast(node.expression, depth + 1u, mask);
-
-      std::cout << '\n';
-      draw_p(depth, mask);
-      std::cout << "clause_true: ";
-      std::cout << "\x1b[97m";
-      dump_ast(node.clause_true, depth + 1u, mask);
-
-      std::cout << '\n';
-      draw_p(depth, mask);
-      std::cout << "clause_false: ";
-      std::cout << "\x1b[97m";
-      dump_ast(node.clause_false, depth + 1u, mask);
-    },
-
-
-    [&](Node::block_t            &node) {
-      for (std::size_t i = 0; i < node.code.size(); ++i)
-        dump_ast(node.code[i], depth, mask);
-    },
-
-    [&](Node::unary_operation_t  &node) {
-      std::cout << '\n';
-      draw_p(depth, mask);
-      std::cout << "operator: ";
-      std::wcout << L"\x1b[95m";
-      std::cout << node.operation->representation;
-
-      mask |= static_cast<std::uint64_t>(1) << depth;
-      dump_ast(node.expression, depth, mask);
-    },
-
-    [&](Node::binary_operation_t &node) {
-      std::cout << '\n';
-      draw_p(depth, mask);
-      std::cout << "operator: ";
-      std::wcout << L"\x1b[95m";
-      std::cout << node.operation->representation;
-
-      for (std::size_t i = 0; i < node.operands.size(); ++i)
-        dump_ast(node.operands[i], depth, mask);
-    },
-
-    [&](Node::function_call_t    &node) {
-      std::cout << '\n';
-      draw_p(depth, mask);
-      std::cout << "expression: ";
-      dump_ast(node.expression, depth + 1u, mask | (1u << (depth + 1u)));
-
-      std::cout << '\n';
-      draw_p(depth, mask);
-      std::cout << "arguments: ";
-      dump_ast(node.arguments, depth + 1u, mask | (1u << (depth + 1u)));
-    },
-
-    [&](Node::value_function_t   &node) {
-      std::cout
-        << "\x1b[39m\x1b[44mFUNCTION\x1b[49m"
-        << "(\x1b[33m0x" << std::setw(4) << std::setfill('0') << std::hex << node.owned_context->id << "\x1b[39m)\n";
-      draw_p(depth, mask | (0ul << (depth + 0u)));
-      std::cout << "parameters:";
-      for (std::size_t i = 0; i < node.parameters.size(); ++i)
-        dump_ast(node.parameters[i], depth + 1, mask);
-
-      dump_ast(node.body, depth, mask);
-    },
-    [&](Node::value_tuple_t      &node) {
-      std::cout << "\x1b[39m\x1b[44mTUPLE\x1b[49m";
-      for (std::size_t i = 0; i < node.entries.size(); ++i)
+  void AstDump::enter(akbit::system::Node const * node_, std::size_t slot)
+  {
+    using akbit::system::Node;
+
+    auto depth = ~static_cast<std::uint32_t>(0);
+    if (frames.empty())
+      root = node_;
+
+    // Labels of the children are printed by their parent
+    if (!frames.empty())
+    {
+      depth = frames.back().depth;
+
+      akbit::system::dispatch(*frames.back().node, akbit::system::overloaded {
+        [&](Node const &, auto const &) { },
+
+        [&](Node const &, Node::declaration_t const &) {
+          if (slot == 2) return;
+
+          std::cout << '\n';
+          draw_p(depth, ended);
+          std::cout << (slot == 0 ? "variable: " : "type: ");
+          // std::cout << "\x1b[97m";
+          ++depth;
+        },
+
+        [&](Node const &, Node::condition_t const &) {
+          static char const * const labels[] = { "expression: ", "clause_true: ", "clause_false: " };
+
+          std::cout << '\n';
+          draw_p(depth, ended);
+          std::cout << labels[slot];
+          std::cout << "\x1b[97m";
+          ++depth;
+        },
+
+        [&](Node const &, Node::function_call_t const &) {
+          std::cout << '\n';
+          draw_p(depth, ended);
+          std::cout << (slot == 0 ? "expression: " : "arguments: ");
+          ++depth;
+        },
+
+        [&](Node const &, Node::value_function_t const &parent) {
+          if (slot < parent.parameters.size())
+            ++depth;
+        },
+      });
+    }
+
+    std::cout << '\n';
+    draw_p(depth, ended);
+    ++depth;
+
+    if (nullptr == node_)
+    {
+      std::cout << "\x1b[44mVOID*\x1b[49m";
+      return;
+    }
+
+    auto &node = *node_;
+    std::cout << get_node_type_name(node) << ": ";
+
+    frame_t frame{ node_, depth, ~static_cast<std::uint32_t>(0), false };
+
+    akbit::system::dispatch(node, akbit::system::overloaded {
+      [&](Node const &, auto const &) { std::cout << "\x1b[44mUNKNOWN*\x1b[49m"; },
+
+      [&](Node const &, Node::module_t const &) { },
+      [&](Node const &, Node::declaration_t const &) { },
+      [&](Node const &, Node::condition_t const &) { },
+      [&](Node const &, Node::block_t const &) { },
+      [&](Node const &, Node::function_call_t const &) {
+        // Both parts are drawn as the last branch of their label
+        frame.column = depth + 1;
+        frame.was_ended = end_column(frame.column);
+      },
+
+      [&](Node const &, Node::unary_operation_t const &node) {
+        std::cout << '\n';
+        draw_p(depth, ended);
+        std::cout << "operator: ";
+        std::wcout << L"\x1b[95m";
+        std::cout << node.operation->representation;
+
+        frame.column = depth;
+        frame.was_ended = end_column(frame.column);
+      },
+
+      [&](Node const &, Node::binary_operation_t const &node) {
+        std::cout << '\n';
+        draw_p(depth, ended);
+        std::cout << "operator: ";
+        std::wcout << L"\x1b[95m";
+        std::cout << node.operation->representation;
+      },
+
+      [&](Node const &, Node::value_function_t const &node) {
+        std::cout
+          << "\x1b[39m\x1b[44mFUNCTION\x1b[49m"
+          << "(\x1b[33m0x" << std::setw(4) << std::setfill('0') << std::hex << node.owned_context->id << "\x1b[39m)\n";
+        draw_p(depth, ended);
+        std::cout << "parameters:";
+      },
+      [&](Node const &, Node::value_tuple_t const &) {
+        std::cout << "\x1b[39m\x1b[44mTUPLE\x1b[49m";
+      },
+
+      [&](Node const &, Node::value_variable_t const &node) {
+        std::cout << names.spelling(node.name);
+        auto record = node.record;
+        if (record)
+        {
+          std::cout << "\x1b[33m(0x" << std::setw(4) << std::setfill('0') << std::hex << record->context->id << ")\x1b[39m";
+        }
+        else
+        {
+          std::cout << "\x1b[33m(" << "------" << ")\x1b[39m";
+        }
+      },
+
+      [&](Node const &, Node::value_string_t const &node) { std::cout << akbit::system::parsing::quote_string(node.value); },
+      [&](Node const &, Node::value_character_t const &node) {
+        std::string text;
+        akbit::system::encode_utf8(node.value, text);
+        auto spelling = akbit::system::parsing::quote_string(text);
+        std::cout << '\'' << spelling.substr(1, spelling.size() - 2);
+      },
+      [&](Node const &, Node::value_integer_t const &node) { std::cout << node.value; },
+      [&](Node const &, Node::value_decimal_t const &node) { std::cout << node.value; },
+    });
+
+    frames.push_back(frame);
+  }
+
+  void AstDump::leave(akbit::system::Node const * node)
+  {
+    if (nullptr == node) return;
+
+    auto frame = frames.back();
+    frames.pop_back();
+
+    std::cout << '\n';
+    bool was_ended = end_column(frame.depth);
+    draw_p(frame.depth, ended);
+    restore_column(frame.depth, was_ended);
+    std::cout << "result_type: " << akbit::system::etype_to_str(node->result_type);
+
+    restore_column(frame.column, frame.was_ended);
+  }
+
+  /// Ends the dump of a module with whether it has errors
+  void print_result(bool has_errors)
+  {
+    std::cout << "\n\x1b[39mResult: "
+      << (has_errors ? "\x1b[01;41mFAILURE" : "\x1b[01;44mSUCCESS")
+      << "\x1b[49m\x1b[00;39m" << std::endl;
+  }
+
+  void AstDump::finish()
+  {
+    auto module = (root ? root->as<akbit::system::Node::module_t>() : nullptr);
+    if (nullptr == module) return;
+
+    print_result(module->has_errors);
+  }
+
+
+  /// Builds the flat copy of the tree that code is generated from
+  class FlattenPass final : public akbit::system::NodePass
+  {
+  public:
+    explicit FlattenPass(akbit::system::FlatTree &result_)
+      : result(result_)
+    { }
+
+    void enter(akbit::system::Node const * node, std::size_t) override { builder.enter(node); }
+    void leave(akbit::system::Node const * node) override { builder.leave(node); }
+    void finish() override { result = builder.take(); }
+
+  private:
+    akbit::system::FlatTree &result;
+    akbit::system::FlatTreeBuilder builder;
+  };
+
+
+  struct options_t
+  {
+    std::size_t lexer_threads = 1;
+    std::size_t annotation_threads = 1;
+    std::size_t generation_threads = 1;
+    bool ast_stats = false;
+    bool time_report = false;
+    bool stream = false;
+    bool watch = false;
+    std::vector<std::string_view> skipped;
+    std::string_view last_pass;
+  };
+
+  /// Compiles one source file a top-level statement at a time.
+  /// Every statement is annotated against the global context, written out
+  /// and freed before the next one is parsed, so that the memory used
+  /// depends on the largest statement rather than on the whole file.
+  /// The passes are the ones of `compile`, those after lex run together
+  /// on every statement and are reported as one
+  bool compile_stream(akbit::system::SourceBuffer const &source, std::string const &output,
+    akbit::system::Session &session, options_t const &options, bool dump,
+    std::vector<akbit::system::Pipeline::record_t> &records)
+  {
+    using akbit::system::code_generation::GenerationTarget;
+    using clock = std::chrono::steady_clock;
+
+    akbit::system::parsing::LiteralPool literals;
+    akbit::system::parsing::LexerState lexer(source.text(), literals);
+    std::optional<akbit::system::parsing::TokenStream> tokens;
+
+    // There is no tree of the whole module
+    akbit::system::Node * ast = nullptr;
+    akbit::system::Pipeline pipeline(session, ast, options.time_report);
+
+    pipeline.add({
+      .name = "lex",
+      .dependencies = {},
+      .run = [&] {
+        // The source is validated a piece at a time and dropped behind,
+        // so that the whole file is not in memory at once
+        constexpr std::uint64_t piece = 1024 * 1024;
+        for (std::uint64_t checked = 0; checked < source.size();)
+        {
+          if (!akbit::system::parsing::validate_source(lexer, checked, std::min(source.size(), checked + piece)))
+          {
+            akbit::system::log_error(lexer);
+            return false;
+          }
+          source.discard_before(checked);
+        }
+
+        // Tokens are always lexed on demand, so that only a few are kept
+        tokens.emplace(lexer);
+        return true;
+      },
+    });
+
+    // The other passes only pick what is done to every statement,
+    // the statements are streamed once the pipeline has run
+    std::vector<std::string> stages;
+    auto add_stage = [&](std::string name, std::vector<std::string> dependencies) {
+      pipeline.add({
+        .name = name,
+        .dependencies = std::move(dependencies),
+        .run = [&stages, name] {
+          stages.push_back(name);
+          return true;
+        },
+      });
+    };
+
+    add_stage("parse", { "lex" });
+    add_stage("annotate", { "parse" });
+    add_stage("flatten", { "annotate" });
+    if (options.ast_stats)
+      add_stage("ast-stats", { "flatten" });
+    if (dump)
+      add_stage("dump", { "annotate" });
+    add_stage("generate", { "flatten" });
+
+    for (auto name : options.skipped)
+      pipeline.skip(name);
+    if (!options.last_pass.empty())
+      pipeline.stop_after(options.last_pass);
+
+    bool succeeded = pipeline.run(akbit::system::diagnostics(std::cerr));
+    records = pipeline.records();
+    if (!succeeded || stages.empty())
+      return succeeded;
+
+    auto runs = [&](std::string_view name) {
+      return std::find(stages.begin(), stages.end(), name) != stages.end();
+    };
+
+    std::ofstream js_output_file;
+    if (runs("generate"))
+    {
+      js_output_file.open(output);
+      if (!js_output_file)
       {
-        // if (i == node.entries.size() - 1)
-        //   mask |= static_cast<std::uint64_t>(1) << depth;
-        dump_ast(node.entries[i], depth, mask);
+        akbit::system::diagnostics(std::cerr) << output << " could not be written" << std::endl;
+        return false;
       }
-    },
+      js_output_file << akbit::system::code_generation::module_header(GenerationTarget::Javascript);
+    }
+
+    // The records of the stages are replaced by one of the whole stream
+    akbit::system::Pipeline::record_t record{ {}, {}, 0, 0 };
+    records.resize(records.size() - stages.size());
+    for (auto &name : stages)
+      record.name += (record.name.empty() ? "" : " + ") + name;
 
-    [&](Node::value_variable_t   &node) {
-      std::cout << node.name;
-      auto record = node.record;
-      if (record.lock())
+    auto allocated = session.allocated();
+    auto start = clock::now();
+
+    // Global declarations live in the session of the compilation,
+    // everything else of a statement lives in a session of its own
+    auto global = session.make<akbit::system::Context>(session, nullptr);
+    akbit::system::Session statement_session;
+    akbit::system::parsing::StatementParser parser(*tokens, source.text(), statement_session);
+
+    // A statement with a syntax error is the last one, it is annotated
+    // and dumped but nothing is generated from it
+    for (akbit::system::Node * statement; parser.next(statement); statement_session.reset())
+    {
+      if (runs("annotate"))
+        akbit::system::annotation::generate_context(statement, global, statement_session);
+
+      if (runs("dump"))
       {
-        std::cout << "\x1b[33m(0x" << std::setw(4) << std::setfill('0') << std::hex << record.lock()->context.lock()->id << ")\x1b[39m";
+        AstDump dumper(literals);
+        akbit::system::walk(static_cast<akbit::system::Node const *>(statement),
+          [&](akbit::system::Node const * node, std::size_t slot) { dumper.enter(node, slot); },
+          [&](akbit::system::Node const * node) { dumper.leave(node); });
+        dumper.finish();
       }
-      else
+
+      if (runs("flatten") && !parser.is_failed())
+      {
+        akbit::system::FlatTree flat(statement);
+        if (options.time_report)
+          record.nodes += flat.size();
+        if (runs("ast-stats"))
+          print_ast_stats(statement, flat);
+        if (runs("generate"))
+          js_output_file << akbit::system::code_generation::generate(flat, literals, GenerationTarget::Javascript, nullptr) << ";\n";
+      }
+
+      literals.release_before(parser.lookahead());
+      source.discard_before(parser.lookahead().index);
+    }
+
+    record.time = clock::now() - start;
+    record.allocated = session.allocated() - std::min(allocated, session.allocated());
+    records.push_back(std::move(record));
+
+    // The errors may come from the lexer, when it reaches the end of the
+    // stream, as well as from the parser
+    bool failed = parser.is_failed();
+    if (runs("dump"))
+      print_result(failed);
+
+    if (runs("generate"))
+    {
+      js_output_file.close();
+      if (!failed && !js_output_file)
+        akbit::system::diagnostics(std::cerr) << output << " could not be written" << std::endl;
+
+      // What was written before the error is not a program
+      if (failed || !js_output_file)
+      {
+        std::error_code ignored;
+        std::filesystem::remove(output, ignored);
+        return false;
+      }
+    }
+    return !failed;
+  }
+
+
+  /// Compiles one source file into a JavaScript file
+  /// \param output path of the generated file
+  /// \param session arena of the compilation, the caller resets it afterwards
+  /// \param dump whether the annotated tree is printed to the standard output
+  /// \param records receives the records of the passes that have run
+  /// \return false if a pass has failed
+  bool compile(akbit::system::SourceBuffer const &source, std::string const &output,
+    akbit::system::Session &session, options_t const &options, bool dump,
+    std::vector<akbit::system::Pipeline::record_t> &records)
+  {
+    if (options.stream)
+      return compile_stream(source, output, session, options, dump, records);
+
+    akbit::system::parsing::LiteralPool literals;
+    akbit::system::parsing::LexerState lexer(source.text(), literals);
+
+    std::vector<akbit::system::parsing::Token> lexed;
+    std::optional<akbit::system::parsing::TokenStream> tokens;
+    akbit::system::Node * ast = nullptr;
+    akbit::system::FlatTree flat;
+
+    akbit::system::Pipeline pipeline(session, ast, options.time_report);
+
+    pipeline.add({
+      .name = "lex",
+      .dependencies = {},
+      .run = [&] {
+        if (!akbit::system::parsing::validate_source(lexer))
+        {
+          akbit::system::log_error(lexer);
+          return false;
+        }
+
+        // Tokens are lexed on demand while parsing,
+        // unless the whole file is lexed up front on several threads
+        if (options.lexer_threads > 1)
+        {
+          bool failed = false;
+          lexed = akbit::system::parsing::tokenize_parallel(source.text(), literals, options.lexer_threads, &failed);
+          tokens.emplace(lexed, literals, failed);
+        }
+        else tokens.emplace(lexer);
+        return true;
+      },
+    });
+
+    pipeline.add({
+      .name = "parse",
+      .dependencies = { "lex" },
+      .run = [&] {
+        // Nothing is generated from a module with errors
+        ast = akbit::system::parsing::parse(*tokens, source.text(), session);
+        return nullptr != ast && !std::get<akbit::system::Node::module_t>(ast->value).has_errors;
+      },
+    });
+
+    pipeline.add({
+      .name = "annotate",
+      .dependencies = { "parse" },
+      .run = [&] {
+        // Global functions are annotated on several threads if asked for
+        std::optional<akbit::system::ThreadPool> pool;
+        if (options.annotation_threads > 1)
+          pool.emplace(options.annotation_threads);
+
+        akbit::system::annotation::generate_context(ast, session, pool ? &*pool : nullptr);
+        return true;
+      },
+    });
+
+    // Code is generated from a flat copy of the annotated tree
+    pipeline.add({
+      .name = "flatten",
+      .dependencies = { "annotate" },
+      .make_visitor = [&] { return std::make_unique<FlattenPass>(flat); },
+    });
+
+    if (options.ast_stats)
+    {
+      pipeline.add({
+        .name = "ast-stats",
+        .dependencies = { "flatten" },
+        .run = [&] {
+          print_ast_stats(ast, flat);
+          return true;
+        },
+      });
+    }
+
+    if (dump)
+    {
+      pipeline.add({
+        .name = "dump",
+        .dependencies = { "annotate" },
+        .make_visitor = [&] { return std::make_unique<AstDump>(literals); },
+      });
+    }
+
+    pipeline.add({
+      .name = "generate",
+      .dependencies = { "flatten" },
+      .run = [&] {
+        using akbit::system::code_generation::GenerationTarget;
+
+        // Statements are generated into separate buffers on several threads
+        // if asked for, the buffers are written out in order as they are
+        std::vector<std::string> code;
+        if (options.generation_threads > 1)
+        {
+          akbit::system::ThreadPool pool(options.generation_threads);
+          code = akbit::system::code_generation::generate_parts(flat, literals, GenerationTarget::Javascript, nullptr, pool);
+        }
+        else code.push_back(akbit::system::code_generation::generate(flat, literals, GenerationTarget::Javascript, nullptr));
+
+        if (!akbit::system::code_generation::write_output(output.c_str(), code))
+        {
+          akbit::system::diagnostics(std::cerr) << output << " could not be written: " << strerror(errno) << std::endl;
+          return false;
+        }
+        return true;
+      },
+    });
+
+    for (auto name : options.skipped)
+      pipeline.skip(name);
+    if (!options.last_pass.empty())
+      pipeline.stop_after(options.last_pass);
+
+    bool succeeded = pipeline.run(akbit::system::diagnostics(std::cerr));
+    records = pipeline.records();
+
+    // The pipeline stops at a module with syntax errors, what was parsed
+    // of it is still annotated and dumped if the dump would have run
+    auto dumps = [&] {
+      return dump && options.skipped.end() == std::find(options.skipped.begin(), options.skipped.end(), "dump")
+          && (options.last_pass.empty() || options.last_pass == "dump");
+    };
+    if (!succeeded && nullptr != ast && std::get<akbit::system::Node::module_t>(ast->value).has_errors && dumps())
+    {
+      akbit::system::annotation::generate_context(ast, session);
+
+      AstDump dumper(literals);
+      akbit::system::walk(static_cast<akbit::system::Node const *>(ast),
+        [&](akbit::system::Node const * node, std::size_t slot) { dumper.enter(node, slot); },
+        [&](akbit::system::Node const * node) { dumper.leave(node); });
+      dumper.finish();
+    }
+    return succeeded;
+  }
+
+
+  /// Compiles every input into `<output_dir>/<name>.js` on a pool of threads.
+  /// This thread opens the files a few at a time ahead of the workers,
+  /// so that reading the next files overlaps with compiling the current ones.
+  /// Every worker reuses its own session, nothing is shared between the files.
+  /// The diagnostics of a file are kept until it is done and written together,
+  /// every line starting with the path of the file. A file that fails leaves
+  /// no output behind
+  /// \return exit code, a failure if any of the files has failed
+  int compile_batch(std::vector<char const *> const &inputs, std::filesystem::path const &output_dir,
+    std::size_t jobs, options_t const &options)
+  {
+    using akbit::system::Pipeline;
+    using clock = std::chrono::steady_clock;
+
+    std::error_code error;
+    std::filesystem::create_directories(output_dir, error);
+    if (error)
+    {
+      std::cerr << "Output directory could not be created!\n";
+      std::cerr << "Reason: " << error.message() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> outputs;
+    std::set<std::string> taken;
+    for (auto input : inputs)
+    {
+      auto name = std::filesystem::path(input).stem();
+      outputs.push_back((output_dir / name += ".js").string());
+      if (!taken.insert(outputs.back()).second)
       {
-        std::cout << "\x1b[33m(" << "------" << ")\x1b[39m";
+        std::cerr << "Several inputs are compiled into " << outputs.back() << std::endl;
+        return EXIT_FAILURE;
       }
-    },
+    }
+
+    struct worker_t
+    {
+      akbit::system::Session session;
+      /// Records of the passes summed over the files of the worker
+      std::vector<Pipeline::record_t> totals;
+      std::vector<Pipeline::record_t> records;
+    };
+
+    auto start = clock::now();
+
+    akbit::system::ThreadPool pool(jobs);
+    std::vector<worker_t> workers(pool.size());
+    std::atomic<std::size_t> failed = 0;
+    std::mutex messages;
 
-    [&](Node::value_string_t     &node) { std::cout << node.value; },
-    [&](Node::value_character_t  &node) { std::wcout << L'\'' << (wchar_t) node.value; },
-    [&](Node::value_integer_t    &node) { std::cout << node.value; },
-    [&](Node::value_decimal_t    &node) { std::cout << node.value; },
-  }, node.value);
+    // Files that are opened and not compiled yet
+    std::counting_semaphore<> ahead(static_cast<std::ptrdiff_t>(2 * pool.size()));
+
+    for (std::size_t i = 0; i < inputs.size(); ++i)
+    {
+      ahead.acquire();
 
-  std::cout << '\n';
-  draw_p(depth, mask | (1u << depth));
-  std::cout << "result_type: " << akbit::system::etype_to_str(node.result_type);
+      auto source = std::make_shared<akbit::system::SourceBuffer>();
+      if (!source->open(inputs[i]))
+      {
+        auto reason = errno;
+        std::lock_guard lock(messages);
+        std::cerr << inputs[i] << ": file could not be opened: " << strerror(reason) << std::endl;
+        ++failed;
+        ahead.release();
+        continue;
+      }
+      source->prefetch();
+
+      pool.submit([&, i, source](std::size_t index) {
+        auto &worker = workers[index];
+
+        std::stringstream diagnostics;
+        auto previous = akbit::system::capture_diagnostics(&diagnostics);
+        bool succeeded = compile(*source, outputs[i], worker.session, options, false, worker.records);
+        akbit::system::capture_diagnostics(previous);
+
+        worker.session.reset();
+        ahead.release();
+
+        for (std::size_t r = 0; r < worker.records.size(); ++r)
+        {
+          auto &record = worker.records[r];
+          if (r == worker.totals.size())
+            worker.totals.push_back({ record.name, {}, 0, 0 });
+          worker.totals[r].time += record.time;
+          worker.totals[r].allocated += record.allocated;
+          worker.totals[r].nodes += record.nodes;
+        }
+
+        if (!succeeded)
+        {
+          ++failed;
+          std::error_code ignored;
+          std::filesystem::remove(outputs[i], ignored);
+        }
+
+        if (!succeeded || !diagnostics.view().empty())
+        {
+          std::string text;
+          for (std::string line; std::getline(diagnostics, line);)
+            text.append(inputs[i]).append(line.empty() ? ":" : ": ").append(line) += '\n';
+          if (!succeeded)
+            text.append(inputs[i]).append(": compilation failed\n");
+
+          std::lock_guard lock(messages);
+          std::cerr << text << std::flush;
+        }
+      });
+    }
+    pool.wait();
+
+    auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+    std::cerr << std::dec << std::fixed << std::setprecision(3)
+      << "Compiled " << inputs.size() << " files (" << failed << " failed) in " << seconds << " s on "
+      << pool.size() << (pool.size() == 1 ? " thread: " : " threads: ") << std::setprecision(1) << inputs.size() / seconds << " files/s" << std::endl;
+
+    if (options.time_report)
+    {
+      std::vector<Pipeline::record_t> totals;
+      for (auto &worker : workers)
+      {
+        for (std::size_t r = 0; r < worker.totals.size(); ++r)
+        {
+          if (r == totals.size())
+            totals.push_back({ worker.totals[r].name, {}, 0, 0 });
+          totals[r].time += worker.totals[r].time;
+          totals[r].allocated += worker.totals[r].allocated;
+          totals[r].nodes += worker.totals[r].nodes;
+        }
+      }
+      Pipeline::report(std::cerr, totals, true);
+    }
+
+    return (0 == failed ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  /// Compiles the file every time it changes, until the process is stopped.
+  /// Only the statements that have changed and the ones that use their
+  /// declarations are annotated and generated again
+  /// \return exit code, if the file can not be compiled a first time
+  int watch(char const *input, std::string const &output)
+  {
+    using clock = std::chrono::steady_clock;
+
+    akbit::system::IncrementalCompiler compiler;
+    std::optional<std::pair<std::filesystem::file_time_type, std::uintmax_t>> compiled;
+
+    for (;; std::this_thread::sleep_for(std::chrono::milliseconds(100)))
+    {
+      // A file that is being replaced may be missing for a moment
+      std::error_code error;
+      auto time = std::filesystem::last_write_time(input, error);
+      auto size = std::filesystem::file_size(input, error);
+      if (error && !compiled)
+      {
+        std::cerr << input << ": file could not be opened: " << error.message() << std::endl;
+        return EXIT_FAILURE;
+      }
+      if (error || compiled == std::pair(time, size)) continue;
+      compiled = { time, size };
+
+      akbit::system::SourceBuffer source;
+      if (!source.open(input))
+      {
+        std::cerr << input << ": file could not be opened: " << strerror(errno) << std::endl;
+        continue;
+      }
+
+      auto start = clock::now();
+      if (!compiler.compile(source, output.c_str()))
+      {
+        std::cerr << input << ": compilation failed" << std::endl;
+        continue;
+      }
+
+      auto &report = compiler.report();
+      std::cerr << std::dec << std::fixed << std::setprecision(3)
+        << "Compiled " << input << " in " << std::chrono::duration<double, std::milli>(clock::now() - start).count() << " ms: "
+        << report.statements << " statements, " << report.changed << " changed, "
+        << report.dependents << " annotated again for their dependencies, " << report.reused << " reused" << std::endl;
+    }
+  }
 }
 
 int main(int argc, char* argv[])
 {
-  if (argc != 2)
+  options_t options;
+  std::vector<char const *> inputs;
+  std::optional<std::filesystem::path> output_dir;
+  std::size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string_view argument = argv[i];
+    if (argument.starts_with("--lex-threads="))
+      options.lexer_threads = std::strtoul(argv[i] + 14, nullptr, 10);
+    else if (argument.starts_with("--annotate-threads="))
+      options.annotation_threads = std::strtoul(argv[i] + 19, nullptr, 10);
+    else if (argument.starts_with("--generate-threads="))
+      options.generation_threads = std::strtoul(argv[i] + 19, nullptr, 10);
+    else if (argument == "--ast-stats")
+      options.ast_stats = true;
+    else if (argument == "--time-report")
+      options.time_report = true;
+    else if (argument == "--stream")
+      options.stream = true;
+    else if (argument == "--watch")
+      options.watch = true;
+    else if (argument.starts_with("--skip="))
+    {
+      for (auto names = argument.substr(7); !names.empty();)
+      {
+        auto end = std::min(names.find(','), names.size());
+        options.skipped.push_back(names.substr(0, end));
+        names.remove_prefix(std::min(end + 1, names.size()));
+      }
+    }
+    else if (argument.starts_with("--stop-after="))
+      options.last_pass = argument.substr(13);
+    else if (argument.starts_with("--output-dir="))
+      output_dir = argument.substr(13);
+    else if (argument.starts_with("--jobs="))
+      jobs = std::strtoul(argv[i] + 7, nullptr, 10);
+    else
+      inputs.push_back(argv[i]);
+  }
+
+  if (inputs.empty())
   {
     char const *name = (argc > 0 ? argv[0] : "witcc");
-    std::cerr << "Usage: " << name << ' ' << "<filename>" << std::endl;
+    std::cerr << "Usage: " << name << ' '
+      << "[--lex-threads=<count>] [--annotate-threads=<count>] [--generate-threads=<count>] [--ast-stats] [--time-report] [--stream] [--watch] "
+      << "[--skip=<pass>[,<pass>...]] [--stop-after=<pass>] "
+      << "[--output-dir=<directory>] [--jobs=<count>] <filename>...\n"
+      << "Passes: lex, parse, annotate, flatten, ast-stats, dump, generate\n"
+      << "With --stream the passes after lex run on one top-level statement at a time\n"
+      << "With --watch a single file is compiled again every time it changes, reusing what has not\n"
+      << "A single file is dumped and compiled into program.out.js,\n"
+      << "several files or an output directory compile every <name>.ws into <directory>/<name>.js" << std::endl;
     return EXIT_FAILURE;
   }
-  
-  std::ifstream ifs(argv[1]);
-  if (!ifs)
+
+  if (options.watch)
+  {
+    if (inputs.size() > 1 || output_dir)
+    {
+      std::cerr << "Only a single file can be watched" << std::endl;
+      return EXIT_FAILURE;
+    }
+    return watch(inputs.front(), "program.out.js");
+  }
+
+  if (inputs.size() > 1 || output_dir)
+    return compile_batch(inputs, output_dir.value_or("."), jobs, options);
+
+  akbit::system::SourceBuffer source;
+  if (!source.open(inputs.front()))
   {
     std::cerr << "File could not be opened!\n";
     std::cerr << "Reason: " << strerror(errno) << std::endl;
     return EXIT_FAILURE;
   }
-  std::string source((std::istreambuf_iterator<char>(ifs)),
-                     (std::istreambuf_iterator<char>()   ));
-  
-  auto tokens = akbit::system::parsing::tokenize(source);
-  // for (auto t : tokens)
-  //   std::cout << t << std::endl;
-
-  auto ast = akbit::system::parsing::parse(tokens);
-  if (!ast) return EXIT_FAILURE;
-  
-  akbit::system::annotation::preprocess_ast(ast);
-  akbit::system::annotation::generate_context(ast);
-
-  dump_ast(ast, -1u, 0ul);
-  std::cout << "\n\x1b[39mResult: "
-    << (std::get<akbit::system::Node::module_t>(ast->value).has_errors ? "\x1b[01;41mFAILURE" : "\x1b[01;44mSUCCESS")
-    << "\x1b[49m\x1b[00;39m" << std::endl;
-  
-  std::fstream js_output_file;
-	js_output_file.open("program.out.js", std::ios::out);
-  if (js_output_file)
-  {
-    js_output_file << akbit::system::code_generation::generate(ast, akbit::system::code_generation::GenerationTarget::Javascript, nullptr);
-    js_output_file.close();
-  }
 
-  return EXIT_SUCCESS;
+  akbit::system::Session session;
+  std::vector<akbit::system::Pipeline::record_t> records;
+  bool succeeded = compile(source, "program.out.js", session, options, true, records);
+  if (options.time_report)
+    akbit::system::Pipeline::report(std::cerr, records, true);
+
+  return (succeeded ? EXIT_SUCCESS : EXIT_FAILURE);
 }
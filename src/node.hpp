@@ -7,11 +7,14 @@
 #include <cstddef>
 #include <cstdint>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
-#include <memory>
 
 #include "operators.hpp"
+#include "session.hpp"
+#include "symbols.hpp"
 
 
 namespace akbit::system
@@ -21,7 +24,7 @@ namespace akbit::system
 
   struct Node
   {
-    enum struct etype_t
+    enum struct etype_t : std::uint8_t
     {
       unknown,
 
@@ -40,48 +43,48 @@ namespace akbit::system
 
     struct module_t
     {
-      std::vector<std::shared_ptr<Node>> data;
-      std::shared_ptr<Context> global_context;
+      std::vector<Node *> data;
+      Context * global_context;
       bool has_errors;
     };
 
 
     struct declaration_t
     {
-      std::shared_ptr<Node> variable;
-      std::shared_ptr<Node> type;
-      std::shared_ptr<Node> value;
+      Node * variable;
+      Node * type;
+      Node * value;
     };
 
     struct condition_t
     {
-      std::shared_ptr<Node> expression;
-      std::shared_ptr<Node> clause_true;
-      std::shared_ptr<Node> clause_false;
+      Node * expression;
+      Node * clause_true;
+      Node * clause_false;
     };
 
 
     struct block_t
     {
-      std::vector<std::shared_ptr<Node>> code;
+      std::vector<Node *> code;
     };
 
     struct binary_operation_t
     {
       operator_t const * operation;
-      std::vector<std::shared_ptr<Node>> operands;
+      std::vector<Node *> operands;
     };
 
     struct unary_operation_t
     {
       operator_t const * operation;
-      std::shared_ptr<Node> expression;
+      Node * expression;
     };
     
     struct function_call_t
     {
-      std::shared_ptr<Node> expression;
-      std::shared_ptr<Node> arguments;
+      Node * expression;
+      Node * arguments;
     };
 
     struct value_string_t
@@ -108,20 +111,20 @@ namespace akbit::system
 
     struct value_variable_t
     {
-      std::string name;
-      std::weak_ptr<DeclarationRecord> record;
+      symbol_t name;
+      DeclarationRecord * record;
     };
 
     struct value_function_t
     {
-      std::vector<std::shared_ptr<Node>> parameters;
-      std::shared_ptr<Node> body;
-      std::shared_ptr<Context> owned_context;
+      std::vector<Node *> parameters;
+      Node * body;
+      Context * owned_context;
     };
 
     struct value_tuple_t
     {
-      std::vector<std::shared_ptr<Node>> entries;
+      std::vector<Node *> entries;
     };
 
 
@@ -151,19 +154,42 @@ public:
       value_tuple_t
     >;
 
+    /// Kinds of nodes, numbered as the alternatives of `node_variant_t`
+    enum kind_t : std::uint8_t
+    {
+      k_unknown,
+      k_module,
+      k_declaration, k_condition,
+      k_block, k_binary_operation, k_unary_operation, k_function_call,
+      k_value_string, k_value_character, k_value_integer, k_value_decimal,
+      k_value_variable, k_value_function, k_value_tuple,
+    };
+
+    /// Kind of the nodes that hold a `T`
+    template <class T>
+    static constexpr kind_t kind_of = [] {
+      return []<std::size_t... K>(std::index_sequence<K...>) {
+        std::size_t kind = 0;
+        ((std::is_same_v<T, std::variant_alternative_t<K, node_variant_t>> ? (kind = K, true) : false) || ...);
+        return static_cast<kind_t>(kind);
+      }(std::make_index_sequence<std::variant_size_v<node_variant_t>>{});
+    }();
+
   public:
-    std::weak_ptr<Context> context;
+    Context * context = nullptr;
     node_variant_t value;
-    etype_t result_type;
+    etype_t result_type = etype_t::unknown;
 
 
   public:
     Node() = default;
 
+    /// Payloads are moved into place when passed as temporaries
     template <class T>
-    Node(T&& value)
-      : context{}
-      , value(value)
+      requires (!std::is_same_v<std::remove_cvref_t<T>, Node>)
+    Node(T&& value_)
+      : context(nullptr)
+      , value(std::forward<T>(value_))
       , result_type(etype_t::unknown)
     {}
 
@@ -174,8 +200,39 @@ public:
 
   public:
     Node& operator =(Node&) = default;
+
+  public:
+    inline kind_t kind() const noexcept { return static_cast<kind_t>(value.index()); }
+
+    template <class T>
+    inline bool is() const noexcept { return std::holds_alternative<T>(value); }
+
+    /// \return the payload or nullptr if the node holds another one
+    template <class T>
+    inline T * as() noexcept { return std::get_if<T>(&value); }
+
+    template <class T>
+    inline T const * as() const noexcept { return std::get_if<T>(&value); }
   };
 
+  // Every kind has to name the alternative with the same index
+  static_assert(std::variant_size_v<Node::node_variant_t> == Node::k_value_tuple + 1);
+  static_assert(Node::kind_of<Node::unknown_t> == Node::k_unknown
+             && Node::kind_of<Node::module_t> == Node::k_module
+             && Node::kind_of<Node::declaration_t> == Node::k_declaration
+             && Node::kind_of<Node::condition_t> == Node::k_condition
+             && Node::kind_of<Node::block_t> == Node::k_block
+             && Node::kind_of<Node::binary_operation_t> == Node::k_binary_operation
+             && Node::kind_of<Node::unary_operation_t> == Node::k_unary_operation
+             && Node::kind_of<Node::function_call_t> == Node::k_function_call
+             && Node::kind_of<Node::value_string_t> == Node::k_value_string
+             && Node::kind_of<Node::value_character_t> == Node::k_value_character
+             && Node::kind_of<Node::value_integer_t> == Node::k_value_integer
+             && Node::kind_of<Node::value_decimal_t> == Node::k_value_decimal
+             && Node::kind_of<Node::value_variable_t> == Node::k_value_variable
+             && Node::kind_of<Node::value_function_t> == Node::k_value_function
+             && Node::kind_of<Node::value_tuple_t> == Node::k_value_tuple);
+
 
   inline std::string etype_to_str(Node::etype_t t)
   {
@@ -194,14 +251,11 @@ public:
     } 
   }
 
-  inline std::shared_ptr<Node> make_node_bop(std::shared_ptr<Node> left, std::shared_ptr<Node> right, operator_t const * operation)
+  inline Node * make_node_bop(Session &session, Node * left, Node * right, operator_t const * operation)
   {
-    return std::make_shared<Node>(Node::binary_operation_t{
+    return session.make<Node>(Node::binary_operation_t{
       .operation = operation,
-      .operands = {
-        left,
-        right,
-      }
+      .operands = { left, right },
     });
   }
 }
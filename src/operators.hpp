@@ -5,8 +5,9 @@
 
 
 #include <array>
-#include <string>
+#include <cstddef>
 #include <cstdint>
+#include <string_view>
 
 
 namespace akbit::system
@@ -17,27 +18,129 @@ namespace akbit::system
     ASSOC_RIGHT = true,
   };
 
+  /// Index of an operator in `operators_list`
+  enum operator_id_t : std::uint8_t
+  {
+    op_unknown,
+
+    op_member_access,
+    op_power,
+    op_multiplication, op_division, op_modulus,
+    op_addition, op_subtraction,
+    op_greater_equal, op_less_equal, op_greater, op_less,
+    op_equal, op_not_equal,
+    op_bitwise_and, op_bitwise_or,
+    op_logical_and, op_logical_or,
+    op_lambda, op_tuple,
+    op_type_cast,
+    op_assignment,
+  };
+
   struct operator_t
   {
-    std::uint8_t id;
+    operator_id_t id;
     std::uint32_t precedence;
     Associativity associativity;
-    std::string representation;
+    std::string_view representation;
 
-    operator_t(std::uint8_t id, std::string representation_, uint32_t precedence_, Associativity associativity_)
-      : id(id)
+    constexpr operator_t(operator_id_t id_, std::string_view representation_, uint32_t precedence_, Associativity associativity_)
+      : id(id_)
       , precedence(precedence_)
       , associativity(associativity_)
       , representation(representation_)
     { }
   };
 
-  operator_t const * find_operator(std::string representation);
+  inline constexpr std::array<operator_t const, 22> operators_list
+  {
+    operator_t(op_unknown,        ""  ,    0, ASSOC_LEFT ),
+
+
+    operator_t(op_member_access,  "." , 1000, ASSOC_LEFT ),
+
+    operator_t(op_power,          "^" ,  250, ASSOC_RIGHT),
+
+    operator_t(op_multiplication, "*" ,  200, ASSOC_LEFT ),
+    operator_t(op_division,       "/" ,  200, ASSOC_LEFT ),
+    operator_t(op_modulus,        "%" ,  200, ASSOC_LEFT ),
+
+    operator_t(op_addition,       "+" ,  100, ASSOC_LEFT ),
+    operator_t(op_subtraction,    "-" ,  100, ASSOC_LEFT ),
+
+
+    operator_t(op_greater_equal,  ">=",   50, ASSOC_LEFT ),
+    operator_t(op_less_equal,     "<=",   50, ASSOC_LEFT ),
+    operator_t(op_greater,        ">" ,   50, ASSOC_LEFT ),
+    operator_t(op_less,           "<" ,   50, ASSOC_LEFT ),
+
+    operator_t(op_equal,          "==",   40, ASSOC_LEFT ),
+    operator_t(op_not_equal,      "!=",   40, ASSOC_LEFT ),
+
+
+    operator_t(op_bitwise_and,    "&" ,   25, ASSOC_LEFT ),
+    operator_t(op_bitwise_or,     "|" ,   20, ASSOC_LEFT ),
+
+    operator_t(op_logical_and,    "&&",   15, ASSOC_LEFT ),
+    operator_t(op_logical_or,     "||",   10, ASSOC_LEFT ),
+
+
+    operator_t(op_lambda,         "->",    4, ASSOC_RIGHT),
+    operator_t(op_tuple,          "," ,    3, ASSOC_LEFT ),
+
+    operator_t(op_type_cast,      ":" ,    5, ASSOC_LEFT ),
+
+    operator_t(op_assignment,     "=" ,    1, ASSOC_RIGHT),
+    // TODO: Add assignments with operations
+  };
+
+  inline constexpr operator_t const & operator_unknown = operators_list[op_unknown];
+  inline constexpr operator_t const & operator_type_cast = operators_list[op_type_cast];
+
+  namespace operators_detail
+  {
+    constexpr std::size_t table_size = 128;
+
+    /// Operators are one or two characters long,
+    /// the table build checks that the hash keeps all of them apart
+    constexpr std::size_t hash(std::string_view spelling)
+    {
+      std::size_t first = static_cast<unsigned char>(spelling[0]);
+      std::size_t second = (spelling.size() > 1 ? static_cast<unsigned char>(spelling[1]) : 0);
+      return (first ^ (second << 1)) % table_size;
+    }
+
+    constexpr auto table = [] {
+      std::array<std::uint8_t, table_size> slots{};
+      for (auto &operation : operators_list)
+      {
+        if (operation.id == op_unknown)
+          continue;
+        if (operation.id != &operation - operators_list.data())
+          throw "operator ids do not match the positions in operators_list";
+
+        auto &slot = slots[hash(operation.representation)];
+        if (op_unknown != slot)
+          throw "operator hash is not perfect anymore";
+        slot = operation.id;
+      }
+      return slots;
+    }();
+  }
+
+  /// \param representation spelling of the operator
+  /// \return operator or nullptr if there is no such operator
+  constexpr inline operator_t const * find_operator(std::string_view representation) noexcept
+  {
+    using namespace operators_detail;
 
-  extern std::array<operator_t const, 22> const operators_list;
+    if (representation.empty() || representation.size() > 2)
+      return nullptr;
 
-  extern operator_t const & operator_unknown;
-  extern operator_t const & operator_type_cast;
+    auto &operation = operators_list[table[hash(representation)]];
+    return (operation.id != op_unknown && operation.representation == representation
+            ? &operation
+            : nullptr);
+  }
 }
 
 #endif
@@ -0,0 +1,80 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__KEYWORDS_HPP
+#define AKBIT__SYSTEM__KEYWORDS_HPP
+
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+#include "lexing.hpp"
+#include "../symbols.hpp"
+
+
+namespace akbit::system::parsing
+{
+  struct keyword_t
+  {
+    std::string_view spelling;
+    TokenSubType sub_type;
+  };
+
+  constexpr std::array<keyword_t, 4> keywords_list
+  {{
+    { "let",  TokenSubType::t_keyword_let  },
+    { "if",   TokenSubType::t_keyword_if   },
+    { "then", TokenSubType::t_keyword_then },
+    { "else", TokenSubType::t_keyword_else },
+  }};
+
+  namespace keywords_detail
+  {
+    constexpr std::size_t table_size = 8;
+    constexpr std::size_t longest = 4;
+
+    /// Perfect for `keywords_list`, checked while building the table
+    constexpr std::size_t hash(std::string_view spelling)
+    {
+      return (static_cast<unsigned char>(spelling[0]) * 3u + spelling.size()) % table_size;
+    }
+
+    constexpr auto table = [] {
+      std::array<keyword_t const *, table_size> slots{};
+      for (auto &keyword : keywords_list)
+      {
+        auto &slot = slots[hash(keyword.spelling)];
+        if (nullptr != slot)
+          throw "keyword hash is not perfect anymore";
+        slot = &keyword;
+      }
+      return slots;
+    }();
+  }
+
+  /// Recognizes a keyword by its spelling
+  /// \param spelling identifier spelling
+  /// \return keyword subtype or ::t_unknown if the spelling is not a keyword
+  constexpr inline TokenSubType find_keyword(std::string_view spelling) noexcept
+  {
+    using namespace keywords_detail;
+
+    if (spelling.empty() || spelling.size() > longest)
+      return TokenSubType::t_unknown;
+
+    auto keyword = table[hash(spelling)];
+    return (nullptr != keyword && keyword->spelling == spelling
+            ? keyword->sub_type
+            : TokenSubType::t_unknown);
+  }
+
+  // The reserved symbols are the keywords, in the same order
+  static_assert([] {
+    for (std::size_t i = 0; i < keywords_list.size(); ++i)
+      if (builtin_symbols[i] != keywords_list[i].spelling || !is_reserved_symbol(static_cast<symbol_t>(i)))
+        return false;
+    return !is_reserved_symbol(static_cast<symbol_t>(keywords_list.size()));
+  }());
+}
+
+#endif
@@ -1,139 +1,296 @@
+#include <array>
 #include <utility>
 
 #include "lexing.hpp"
+#include "keywords.hpp"
+#include "scanning.hpp"
 #include "../error_handling.hpp"
+#include "../utf8.hpp"
 
 
 namespace akbit::system::parsing
 {
-  void LexerState::move()
+  namespace
   {
-    if (index >= source.size())
-      return;
+    constexpr TokenSubType classify_character(char c)
+    {
+      using tst = TokenSubType;
+
+      switch (c)
+      {
+        case '@': return tst::t_at_sign;
+
+        case '(': return tst::t_brace_round_left;
+        case ')': return tst::t_brace_round_right;
+        case '[': return tst::t_brace_square_left;
+        case ']': return tst::t_brace_square_right;
+        case '<': return tst::t_brace_triangular_left;
+        case '>': return tst::t_brace_triangular_right;
+        case '{': return tst::t_brace_curly_left;
+        case '}': return tst::t_brace_curly_right;
+
+        case '+': return tst::t_plus;
+        case '-': return tst::t_dash;
+        case '~': return tst::t_tilde;
+        case '.': return tst::t_dot;
+        case ',': return tst::t_comma;
+
+        case '*': return tst::t_star;
+        case '/': return tst::t_slash;
+        case '\\': return tst::t_backslash;
+        case '%': return tst::t_percent;
+
+        case '|': return tst::t_vertical_bar;
+        case '&': return tst::t_ampersand;
+        case '^': return tst::t_caret;
+
+        case '=': return tst::t_equal;
+        case '!': return tst::t_exclamation_mark;
+        case '?': return tst::t_question_mark;
+
+        case ':': return tst::t_colon;
+        case ';': return tst::t_semicolon;
+
+        default: return tst::t_unknown;
+      }
+    }
+
+    /// Operators spelled with two characters, the lexer takes the longest one
+    constexpr TokenSubType classify_pair(char first, char second)
+    {
+      using tst = TokenSubType;
+
+      switch (first)
+      {
+        case '>': return second == '=' ? tst::t_greater_equal : tst::t_unknown;
+        case '<': return second == '=' ? tst::t_less_equal : tst::t_unknown;
+        case '=': return second == '=' ? tst::t_double_equal : tst::t_unknown;
+        case '!': return second == '=' ? tst::t_not_equal : tst::t_unknown;
+        case '&': return second == '&' ? tst::t_double_ampersand : tst::t_unknown;
+        case '|': return second == '|' ? tst::t_double_vertical_bar : tst::t_unknown;
+        case '-': return second == '>' ? tst::t_arrow : tst::t_unknown;
+
+        default: return tst::t_unknown;
+      }
+    }
 
-    ++column;
-    if (source[index++] != '\n')
-      return;
+    constexpr std::array<TokenSubType, 256> character_types = [] {
+      std::array<TokenSubType, 256> table{};
+      for (int c = 0; c < 256; ++c)
+        table[c] = classify_character(static_cast<char>(c));
+      return table;
+    }();
 
-    ++line;
-    column = 1;
+    constexpr std::uint32_t invalid_escape = ~static_cast<std::uint32_t>(0);
+
+    /// Code point of the escape sequence '\\c' of string and character literals
+    constexpr std::uint32_t decode_escape(char c)
+    {
+      switch (c)
+      {
+        case 'r': return '\r';
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 's': return ' ';
+        case '\\': return '\\';
+        default: return invalid_escape;
+      }
+    }
+
+    void report_escape(parsing::LexerState &state, char c)
+    {
+      state.error.code = error_t::t_special_character_does_not_exist;
+      state.error.message = std::string("Special character identifier '")
+        + c + "' does not exists";
+    }
+
+    void report_invalid_utf8(parsing::LexerState &state)
+    {
+      state.error.code = error_t::t_invalid_utf8;
+      state.error.message = "Text is not a valid UTF-8 sequence";
+    }
   }
 
-  parsing::TokenSubType get_character_type(char c)
+  std::string quote_string(std::string_view text)
   {
-    using tst = TokenSubType;
+    std::string spelling = "\"";
+    spelling.reserve(text.size() + 2);
 
-    switch (c)
+    for (char c : text)
     {
-      case '@': return tst::t_at_sign;
-
-      case '(': return tst::t_brace_round_left;
-      case ')': return tst::t_brace_round_right;
-      case '[': return tst::t_brace_square_left;
-      case ']': return tst::t_brace_square_right;
-      case '<': return tst::t_brace_triangular_left;
-      case '>': return tst::t_brace_triangular_right;
-      case '{': return tst::t_brace_curly_left;
-      case '}': return tst::t_brace_curly_right;
-
-      case '+': return tst::t_plus;
-      case '-': return tst::t_dash;
-      case '~': return tst::t_tilde;
-      case '.': return tst::t_dot;
-      case ',': return tst::t_comma;
-
-      case '*': return tst::t_star;
-      case '/': return tst::t_slash;
-      case '\\': return tst::t_backslash;
-      case '%': return tst::t_percent;
-
-      case '|': return tst::t_vertical_bar;
-      case '&': return tst::t_ampersand;
-      case '^': return tst::t_caret;
-
-      case '=': return tst::t_equal;
-      case '!': return tst::t_exclamation_mark;
-      case '?': return tst::t_question_mark;
-
-      case ':': return tst::t_colon;
-      case ';': return tst::t_semicolon;
-
-      default: return tst::t_unknown;
+      switch (c)
+      {
+        case '"':  spelling += "\\\""; break;
+        case '\\': spelling += "\\\\"; break;
+        case '\r': spelling += "\\r"; break;
+        case '\n': spelling += "\\n"; break;
+        case '\t': spelling += "\\t"; break;
+        default:   spelling += c;
+      }
     }
+
+    spelling += '"';
+    return spelling;
+  }
+
+  bool validate_source(parsing::LexerState &state)
+  {
+    auto offset = get_scan_kernels().find_invalid_utf8(state.source.data(), state.source.size());
+    if (offset == state.source.size())
+      return true;
+
+    state.index = offset;
+    report_invalid_utf8(state);
+    return false;
+  }
+
+  bool validate_source(parsing::LexerState &state, std::uint64_t &checked, std::uint64_t end)
+  {
+    auto size = end - checked;
+    auto offset = get_scan_kernels().find_invalid_utf8(state.source.data() + checked, size);
+
+    // A UTF-8 sequence takes at most 4 bytes
+    bool is_cut = (end < state.source.size() && size - offset < 4);
+    if (offset == size || is_cut)
+    {
+      checked += offset;
+      return true;
+    }
+
+    state.index = checked + offset;
+    report_invalid_utf8(state);
+    return false;
+  }
+
+  parsing::TokenSubType get_character_type(char c)
+  {
+    return character_types[static_cast<unsigned char>(c)];
   }
 
   parsing::Token get_next_token(parsing::LexerState &state)
   {
-    while (std::isspace(state.peek()))
-      state.move();
+    auto const &kernels = get_scan_kernels();
+    char const *base = state.source.data();
+
+    // Whitespaces and comments are skipped in a loop,
+    // the padding after the text stops every scan
+    while (true)
+    {
+      if (has_class(state.peek(), cc_whitespace))
+        state.index = kernels.skip_whitespace(base + state.index + 1) - base;
+
+      if (state.peek() != '/' || base[state.index + 1] != '/')
+        break;
+
+      // A '\0' inside of the text does not terminate a comment
+      char const *position = kernels.skip_line(base + state.index + 2);
+      while (*position == '\0' && static_cast<std::uint64_t>(position - base) < state.source.size())
+        position = kernels.skip_line(position + 1);
+
+      state.index = position - base;
+    }
 
     if (state.is_eof())
     {
-      return parsing::Token{
-        state.index, state.line, state.column,
-        "##EOF##",
-        TokenType::t_eof, TokenSubType::t_eof
-      };
+      return make_eof_token(state.index);
     }
 
     auto sub_type = get_character_type(state.peek());
     if (sub_type != TokenSubType::t_unknown)
     {
-      state.move();
-
-      // skipping comments
-      if (sub_type == TokenSubType::t_slash && state.peek() == '/')
-      {
-        do state.move();
-        while (state.peek() != '\n');
-
-        // TODO: remove the recursion
-        return get_next_token(state);
-      }
+      std::uint64_t start = state.index;
+      auto pair = classify_pair(state.peek(), base[start + 1]);
+      state.index += (pair != TokenSubType::t_unknown ? 2 : 1);
 
       return parsing::Token{
-        state.index - 1, state.line, state.column - 1,
-        state.source.substr(state.index - 1, 1),
+        start,
+        state.source.substr(start, state.index - start),
         TokenType::t_operator,
-        sub_type
+        (pair != TokenSubType::t_unknown ? pair : sub_type),
+        0
       };
     }
 
     if (state.peek() == '"')
     {
-      std::uint32_t length = 1;
-      do
+      std::uint64_t start = state.index;
+      char const *position = base + start + 1;
+      char const *end = base + state.source.size();
+
+      // Literals are copied only after the first escape sequence,
+      // the text of the others is their spelling
+      std::string text;
+      bool has_escapes = false;
+
+      while (true)
       {
-        state.move(), ++length;
+        char const *run = position;
+        position = kernels.skip_string_body(position);
+        if (has_escapes)
+          text.append(run, position);
 
-        if (state.peek() == '\\')
-          state.move(), ++length;
-        
-        if (state.peek() == '\0')
-        {
-          state.error.code = error_t::t_unexpected_eof;
-          state.error.message = "String was not closed";
+        if (*position == '"')
           break;
+
+        if (has_class(*position, cc_non_ascii))
+        {
+          std::uint32_t code_point;
+          auto length = decode_utf8(position, end - position, code_point);
+          if (length == 0)
+          {
+            report_invalid_utf8(state);
+            break;
+          }
+
+          if (has_escapes)
+            text.append(position, length);
+          position += length;
+          continue;
         }
-      } while (state.peek() != '"');
+
+        if (*position == '\\' && position[1] != '\0')
+        {
+          auto code_point = (position[1] == '"' ? std::uint32_t('"') : decode_escape(position[1]));
+          if (code_point == invalid_escape)
+          {
+            report_escape(state, position[1]);
+            break;
+          }
+
+          if (!has_escapes)
+            text.assign(base + start + 1, position), has_escapes = true;
+          text += static_cast<char>(code_point);
+          position += 2;
+          continue;
+        }
+
+        state.error.code = error_t::t_unexpected_eof;
+        state.error.message = "String was not closed";
+        break;
+      }
+
+      state.index = position - base;
       state.move();
 
       return parsing::Token{
-        state.index - length, state.line, state.column - length,
+        start,
 
-        state.source.substr(state.index - length, length),
+        state.source.substr(start, state.index - start),
 
         TokenType::t_string,
-        TokenSubType::t_string
+        TokenSubType::t_string,
+
+        (has_escapes ? state.literals->add(std::move(text)) : LiteralPool::verbatim)
       };
     }
 
     if (state.peek() == '\'')
     {
       state.move();
-      std::uint32_t length = 1;
+      std::uint64_t start = state.index;
+      std::uint32_t code_point = 0;
 
-      if (std::isspace(state.peek()) || std::iscntrl(state.peek()))
+      if (has_class(state.peek(), cc_whitespace | cc_control))
       {
         state.error.code = error_t::t_misleading_character;
         state.error.message =
@@ -143,76 +300,102 @@ namespace akbit::system::parsing
           "  \\t - tabulation\n"
           "  \\n - new line\n"
           "  \\r - carriage return";
+        state.move();
       }
-
-      if (state.peek() == '\\')
+      else if (state.peek() == '\\')
       {
-        state.move(), ++length;
-        switch(state.peek())
-        {
-          case 'r': case 'n': case 't': case 's': break;
-          default:
-          state.error.code = error_t::t_special_character_does_not_exist;
-          state.error.message = std::string("Special character identifier '")
-            + state.peek() + "' does not exists";
-        }
+        state.move();
+        code_point = decode_escape(state.peek());
+        if (code_point == invalid_escape)
+          report_escape(state, state.peek());
+        state.move();
+      }
+      else
+      {
+        auto length = decode_utf8(base + start, state.source.size() - start, code_point);
+        if (length == 0)
+          report_invalid_utf8(state), length = 1;
+        state.index += length;
       }
-
-      state.move();
 
       return parsing::Token{
-        state.index - length, state.line, state.column - length,
+        start,
 
-        state.source.substr(state.index - length, length),
+        state.source.substr(start, state.index - start),
 
         TokenType::t_character, TokenSubType::t_character,
+        code_point
       };
     }
 
-    if ('0' <= state.peek() && state.peek() <= '9')
+    if (has_class(state.peek(), cc_digit))
     {
-      std::uint32_t length = 0;
+      std::uint64_t start = state.index;
       bool is_decimal = false;
-      do state.move(), ++length;
-      while (false
-             || std::isdigit(state.peek())
-             || (state.peek() == '.' && !is_decimal && (is_decimal = true)));
+
+      state.index = kernels.skip_digits(base + start + 1) - base;
+      if (state.peek() == '.')
+      {
+        is_decimal = true;
+        state.index = kernels.skip_digits(base + state.index + 1) - base;
+      }
 
       return parsing::Token{
-        state.index - length, state.line, state.column - length,
+        start,
 
-        state.source.substr(state.index - length, length),
+        state.source.substr(start, state.index - start),
 
         TokenType::t_number,
         (is_decimal
          ? TokenSubType::t_decimal
-         : TokenSubType::t_integer)
+         : TokenSubType::t_integer),
+        0
       };
     }
 
-    if (false
-        || std::isalpha(state.peek())
-        || state.peek() == '_' || state.peek() == '$')
+    // Every code point outside of ASCII may be a part of an identifier
+    if (has_class(state.peek(), cc_identifier_start | cc_non_ascii))
     {
-      std::uint32_t length = 0;
-      do state.move(), ++length;
-      while (false
-             || std::isalnum(state.peek())
-             || state.peek() == '_' || state.peek() == '$');
+      std::uint64_t start = state.index;
+      char const *position = base + start;
+
+      while (true)
+      {
+        position = kernels.skip_identifier(position);
+        if (!has_class(*position, cc_non_ascii))
+          break;
+
+        std::uint32_t code_point;
+        auto length = decode_utf8(position, base + state.source.size() - position, code_point);
+        if (length == 0)
+        {
+          report_invalid_utf8(state);
+          break;
+        }
+        position += length;
+      }
+
+      state.index = position - base;
+      auto spelling = state.source.substr(start, state.index - start);
+      auto keyword = find_keyword(spelling);
+      if (keyword != TokenSubType::t_unknown)
+        return parsing::Token{ start, spelling, TokenType::t_keyword, keyword, 0 };
 
       return parsing::Token{
-        state.index - length, state.line, state.column - length,
-        state.source.substr(state.index - length, length),
+        start,
+        spelling,
 
-        TokenType::t_identifier, TokenSubType::t_identifier
+        TokenType::t_identifier, TokenSubType::t_identifier,
+        state.literals->intern(spelling)
       };
     }
 
     auto ret = parsing::Token{
-      state.index, state.line, state.column,
+      state.index,
       state.source.substr(state.index, 1),
 
-      TokenType::t_unknown, TokenSubType::t_unknown
+      TokenType::t_unknown, TokenSubType::t_unknown,
+      0
     };
 
     state.move();
@@ -222,19 +405,22 @@ namespace akbit::system::parsing
 
 namespace akbit::system::parsing
 {
-  std::vector<Token> tokenize(std::string &source)
+  std::vector<Token> tokenize(std::string_view source, LiteralPool &literals, bool * failed)
   {
     std::vector<Token> tokens{};
-    parsing::LexerState state(source);
+    parsing::LexerState state(source, literals);
 
-    while (state.index < source.size() && not state.is_error_occurred())
-      tokens.push_back(get_next_token(state));
+    do tokens.push_back(get_next_token(state));
+    while (tokens.back().type != TokenType::t_eof && not state.is_error_occurred());
 
     if (state.is_error_occurred())
     {
       log_error(state);
+      tokens.push_back(make_eof_token(state.index));
     }
 
+    if (nullptr != failed)
+      *failed = state.is_error_occurred();
     return tokens;
   }
 }
@@ -6,21 +6,25 @@
 
 #include <cstddef>
 #include <cctype>
+#include <cstdint>
 #include <vector>
 #include <string>
+#include <string_view>
 
 #include "../error.hpp"
+#include "literals.hpp"
 
 
 namespace akbit::system::parsing
 {
-  enum class TokenType
+  enum class TokenType : std::uint8_t
   {
     t_unknown,
 
     t_commentary,
 
     t_identifier,
+    t_keyword,
     t_number,
     t_string,
     t_character,
@@ -30,13 +34,14 @@ namespace akbit::system::parsing
     t_eof,
   };
 
-  enum class TokenSubType
+  enum class TokenSubType : std::uint8_t
   {
     t_unknown,
 
     t_inline_commentary, t_multiline_commentary,
 
     t_identifier,
+    t_keyword_let, t_keyword_if, t_keyword_then, t_keyword_else,
     t_integer, t_decimal,
     t_string,
     t_character,
@@ -57,21 +62,58 @@ namespace akbit::system::parsing
     t_equal, t_exclamation_mark, t_question_mark,
     t_colon, t_semicolon,
 
+    t_greater_equal, t_less_equal,
+    t_double_equal, t_not_equal,
+    t_double_ampersand, t_double_vertical_bar,
+    t_arrow,
+
     t_eof,
   };
 
   struct Token
   {
   public:
-    std::uint32_t index, line, column;
+    /// Byte offset of the first character,
+    /// line and column are resolved only for diagnostics
+    std::uint64_t index;
 
-    std::string value;
+    /// Spelling of the token, points into the source buffer
+    std::string_view value;
     TokenType type;
     TokenSubType sub_type;
 
+    /// Decoded value of a literal: the code point of a character,
+    /// the LiteralPool id of the text of a string, the symbol of an identifier
+    std::uint32_t literal;
+
     friend std::ostream &operator<<(std::ostream &, Token &);
   };
 
+  /// Hash that a fingerprint of no tokens starts from
+  constexpr std::uint64_t fingerprint_basis = 0xcbf29ce484222325;
+
+  /// Folds the kind and the spelling of the token into a 64-bit FNV-1a hash
+  inline std::uint64_t fingerprint(std::uint64_t hash, Token const &token) noexcept
+  {
+    constexpr std::uint64_t prime = 0x100000001b3;
+    auto fold = [&](std::uint64_t value) { hash = (hash ^ value) * prime; };
+
+    fold(static_cast<std::uint64_t>(token.type));
+    fold(static_cast<std::uint64_t>(token.sub_type));
+    fold(token.value.size());
+    for (unsigned char c : token.value)
+      fold(c);
+    return hash;
+  }
+
+  /// Spelling of t_eof tokens, shared by all of them
+  extern std::string_view const eof_spelling;
+
+  inline Token make_eof_token(std::uint64_t index)
+  {
+    return Token{ index, eof_spelling, TokenType::t_eof, TokenSubType::t_eof, 0 };
+  }
+
   std::string get_type_name(TokenType type);
   std::string get_sub_type_name(TokenSubType type);
 
@@ -79,8 +121,9 @@ namespace akbit::system::parsing
   
   struct LexerState
   {
-    std::uint32_t index, line, column;
-    std::string &source;
+    std::uint64_t index;
+    std::string_view source;
+    LiteralPool *literals;
 
     struct
     {
@@ -89,15 +132,21 @@ namespace akbit::system::parsing
     } error;
 
   public:
-    LexerState(std::string& source_)
-      : index(0), line(1), column(1)
+    /// \param source_ text to tokenize, has to be followed by
+    ///                `source_padding` zero bytes (see SourceBuffer)
+    /// \param literals_ receives the decoded text of string literals and
+    ///                  the names of identifiers
+    LexerState(std::string_view source_, LiteralPool &literals_)
+      : index(0)
       , source(source_)
+      , literals(&literals_)
       , error{error_t::e_no_errors, ""}
     { }
 
   public:
-    constexpr inline char peek() const { return source[index]; }
-    void move();
+    /// The source is followed by zero padding, so peeking past its end is safe
+    constexpr inline char peek() const { return source.data()[index]; }
+    constexpr inline void move() noexcept { ++index; }
 
     constexpr inline bool is_eof() const noexcept { return index >= source.size(); }
     constexpr inline bool is_error_occurred() const noexcept { return error.code != error_t::e_no_errors; }
@@ -113,8 +162,40 @@ namespace akbit::system::parsing
   /// \return parsed valuable token
   Token get_next_token(parsing::LexerState &state);
 
-
-  std::vector<Token> tokenize(std::string &source);
+  /// Spells a string literal, the lexer decodes the spelling back into the text
+  std::string quote_string(std::string_view text);
+
+  /// Checks that the whole source is valid UTF-8 before it is lexed.
+  /// Tokens validate what they decode, this pass also covers commentaries
+  /// \return false if the source is not valid, the error is stored in the state
+  bool validate_source(parsing::LexerState &state);
+
+  /// Checks the next piece of the source, for a source that is validated
+  /// a piece at a time rather than all at once
+  /// \param checked end of the text validated so far, moved past the piece.
+  ///                A sequence cut by the end of the piece is left for the next one
+  /// \param end end of the piece
+  /// \return false if the piece is not valid, the error is stored in the state
+  bool validate_source(parsing::LexerState &state, std::uint64_t &checked, std::uint64_t end);
+
+
+  /// Splits the whole text into tokens
+  /// \param source text followed by `source_padding` zero bytes
+  /// \param literals receives the decoded text of string literals
+  /// \param failed if given, receives whether there was a lexical error
+  /// \return tokens of the text up to the first lexical error, always ending with a t_eof token
+  std::vector<Token> tokenize(std::string_view source, LiteralPool &literals, bool * failed = nullptr);
+
+  /// Splits the text into tokens on several threads.
+  /// The text is cut into chunks after newlines and every chunk is lexed
+  /// speculatively; chunks that start inside of a literal or a comment are
+  /// re-lexed while the results are stitched together
+  /// \param source text followed by `source_padding` zero bytes
+  /// \param literals receives the decoded text of string literals
+  /// \param thread_count maximal number of threads to use
+  /// \param failed if given, receives whether there was a lexical error
+  /// \return the same tokens tokenize() returns, with the same literal ids
+  std::vector<Token> tokenize_parallel(std::string_view source, LiteralPool &literals, std::size_t thread_count, bool * failed = nullptr);
 }
 
 #endif
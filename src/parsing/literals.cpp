@@ -0,0 +1,85 @@
+#include <algorithm>
+
+#include "literals.hpp"
+#include "lexing.hpp"
+
+
+namespace akbit::system::parsing
+{
+  LiteralPool::LiteralPool()
+  {
+    for (auto name : builtin_symbols)
+      intern(name);
+  }
+
+  std::uint32_t LiteralPool::add(std::string &&text)
+  {
+    std::lock_guard<std::mutex> lock(guard);
+    texts.push_back(std::move(text));
+    return released + static_cast<std::uint32_t>(texts.size() - 1);
+  }
+
+  std::string_view LiteralPool::text(Token const &token) const
+  {
+    if (token.literal == verbatim)
+    {
+      // An unterminated literal has no closing quote
+      auto body = token.value.substr(1);
+      return (!body.empty() && body.back() == '"' ? body.substr(0, body.size() - 1) : body);
+    }
+
+    std::lock_guard<std::mutex> lock(guard);
+    return texts[token.literal - released];
+  }
+
+  void LiteralPool::release_before(Token const &token)
+  {
+    std::lock_guard<std::mutex> lock(guard);
+
+    // The text of the token itself is the last one added, if it has one
+    bool has_text = (token.type == TokenType::t_string && token.literal != verbatim);
+    auto kept = (has_text ? std::size_t(1) : std::size_t(0));
+    while (texts.size() > kept)
+    {
+      texts.pop_front();
+      ++released;
+    }
+  }
+
+  symbol_t LiteralPool::intern(std::string_view name)
+  {
+    {
+      std::shared_lock<std::shared_mutex> lock(names_guard);
+      if (auto found = symbols.find(name); found != symbols.end())
+        return found->second;
+    }
+
+    // Another thread may have interned the name between the two locks
+    std::unique_lock<std::shared_mutex> lock(names_guard);
+    if (auto found = symbols.find(name); found != symbols.end())
+      return found->second;
+
+    // Long names get a block of their own, the next name starts a new one
+    if (name_block_used + name.size() > name_block_size)
+    {
+      name_blocks.emplace_back(new char[std::max(name.size(), name_block_size)]);
+      name_block_used = 0;
+    }
+    char *storage = name_blocks.back().get() + name_block_used;
+    name_block_used = (name.size() > name_block_size ? name_block_size : name_block_used + name.size());
+
+    std::copy(name.begin(), name.end(), storage);
+    std::string_view stored(storage, name.size());
+
+    auto symbol = static_cast<symbol_t>(names.size());
+    names.push_back(stored);
+    symbols.emplace(stored, symbol);
+    return symbol;
+  }
+
+  std::string_view LiteralPool::spelling(symbol_t symbol) const
+  {
+    std::shared_lock<std::shared_mutex> lock(names_guard);
+    return names[symbol];
+  }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__LITERALS_HPP
+#define AKBIT__SYSTEM__LITERALS_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../symbols.hpp"
+
+
+namespace akbit::system::parsing
+{
+  struct Token;
+
+  /// Decoded text of the string literals of a source and the interned
+  /// names of its identifiers.
+  /// Literals without escape sequences are not copied, their text is read
+  /// straight from the spelling of the token. Names are never removed and
+  /// texts only when asked to, so ids and symbols stay valid for tokens
+  /// that are re-lexed or lexed on other threads
+  class LiteralPool
+  {
+  public:
+    /// Id of a literal whose text is its spelling without the quotes
+    static constexpr std::uint32_t verbatim = ~static_cast<std::uint32_t>(0);
+
+  public:
+    /// Starts with the builtin symbols
+    LiteralPool();
+    LiteralPool(LiteralPool const &) = delete;
+    LiteralPool &operator =(LiteralPool const &) = delete;
+
+  public:
+    /// \return id to store in Token::literal
+    std::uint32_t add(std::string &&text);
+
+    /// \param token a t_string token lexed with this pool
+    /// \return decoded text of the literal, valid while the pool and the source live
+    std::string_view text(Token const &token) const;
+
+    /// Drops the texts of the literals lexed before the token.
+    /// Nothing may read the tokens before it any more,
+    /// and no token after it may have been lexed yet
+    void release_before(Token const &token);
+
+    /// \return symbol of the name, the same for every equal name
+    symbol_t intern(std::string_view name);
+
+    /// \return spelling of an interned name, valid while the pool lives
+    std::string_view spelling(symbol_t symbol) const;
+
+  private:
+    mutable std::mutex guard;
+    std::deque<std::string> texts;
+    /// Texts dropped from the front, the id of `texts[i]` is `released + i`
+    std::uint32_t released = 0;
+
+    static constexpr std::size_t name_block_size = 16 * 1024;
+
+    // Spellings are copied into blocks that are never moved,
+    // lookups are shared while interning is exclusive
+    mutable std::shared_mutex names_guard;
+    std::vector<std::unique_ptr<char[]>> name_blocks;
+    std::size_t name_block_used = name_block_size;
+    std::vector<std::string_view> names;
+    std::unordered_map<std::string_view, symbol_t> symbols;
+  };
+}
+
+#endif
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "lexing.hpp"
+#include "../error_handling.hpp"
+
+
+namespace akbit::system::parsing
+{
+  namespace
+  {
+    /// Smaller inputs are not worth starting threads for
+    constexpr std::uint64_t parallel_chunk_minimum = 256 * 1024;
+
+    struct ChunkResult
+    {
+      std::vector<Token> tokens;
+
+      /// Chunks are lexed with pools of their own, so that the ids of the
+      /// shared pool follow the order of the text rather than of the threads
+      std::unique_ptr<LiteralPool> literals;
+      /// Symbol in the shared pool of every symbol of the chunk, once it is met
+      std::vector<symbol_t> symbols;
+
+      bool is_failed = false;
+      std::uint64_t error_index = 0;
+      error_t error_code = error_t::e_no_errors;
+      std::string error_message;
+    };
+
+    /// Lexes every token starting inside [begin, end).
+    /// The chunk may start inside of a string or a comment,
+    /// such tokens are discarded while stitching
+    void lex_chunk(std::string_view source, LiteralPool &literals, std::uint64_t begin, std::uint64_t end, ChunkResult &result)
+    {
+      LexerState state(source, literals);
+      state.index = begin;
+
+      while (true)
+      {
+        auto token = get_next_token(state);
+        if (token.index >= end && token.type != TokenType::t_eof)
+          break;
+
+        result.tokens.push_back(token);
+
+        if (state.is_error_occurred())
+        {
+          result.is_failed = true;
+          result.error_index = state.index;
+          result.error_code = state.error.code;
+          result.error_message = std::move(state.error.message);
+          break;
+        }
+
+        if (token.type == TokenType::t_eof)
+          break;
+      }
+    }
+
+    constexpr symbol_t unmapped = ~static_cast<symbol_t>(0);
+
+    /// Gives a token lexed with the pool of its chunk the ids of the shared pool.
+    /// Tokens are adopted in the order of the text, so names and texts get
+    /// the ids that lexing the text from its start gives them
+    Token adopt(Token token, ChunkResult &chunk, LiteralPool &literals)
+    {
+      if (token.type == TokenType::t_identifier)
+      {
+        if (token.literal >= chunk.symbols.size())
+          chunk.symbols.resize(token.literal + 1, unmapped);
+
+        auto &symbol = chunk.symbols[token.literal];
+        if (symbol == unmapped)
+          symbol = literals.intern(token.value);
+        token.literal = symbol;
+      }
+      else if (token.type == TokenType::t_string && token.literal != LiteralPool::verbatim)
+      {
+        token.literal = literals.add(std::string(chunk.literals->text(token)));
+      }
+      return token;
+    }
+
+    /// Splits the text after newline characters into at most `count` parts
+    std::vector<std::uint64_t> split_at_lines(std::string_view source, std::size_t count)
+    {
+      std::vector<std::uint64_t> bounds{ 0 };
+
+      for (std::size_t i = 1; i < count; ++i)
+      {
+        std::uint64_t target = std::max(source.size() / count * i, bounds.back());
+        auto newline = static_cast<char const *>(std::memchr(source.data() + target, '\n', source.size() - target));
+        if (nullptr == newline)
+          break;
+
+        std::uint64_t bound = newline - source.data() + 1;
+        if (bound > bounds.back() && bound < source.size())
+          bounds.push_back(bound);
+      }
+
+      bounds.push_back(source.size());
+      return bounds;
+    }
+  }
+
+  std::vector<Token> tokenize_parallel(std::string_view source, LiteralPool &literals, std::size_t thread_count, bool * failed)
+  {
+    thread_count = std::min<std::uint64_t>(thread_count, source.size() / parallel_chunk_minimum);
+    if (thread_count <= 1)
+      return tokenize(source, literals, failed);
+
+    auto bounds = split_at_lines(source, thread_count);
+    std::size_t chunk_count = bounds.size() - 1;
+    std::vector<ChunkResult> chunks(chunk_count);
+
+    {
+      // The first chunk is not speculative, its ids are already in order
+      std::vector<std::thread> workers;
+      for (std::size_t i = 1; i < chunk_count; ++i)
+      {
+        chunks[i].literals = std::make_unique<LiteralPool>();
+        workers.emplace_back(lex_chunk, source, std::ref(*chunks[i].literals), bounds[i], bounds[i + 1], std::ref(chunks[i]));
+      }
+
+      lex_chunk(source, literals, bounds[0], bounds[1], chunks[0]);
+
+      for (auto &worker : workers)
+        worker.join();
+    }
+
+    // A token is fully determined by the offset it starts at (character
+    // literals report the offset after their quote, hence the type check),
+    // so once the sequential position meets the start of a speculatively
+    // lexed token, the rest of that chunk is what the sequential lexer produces.
+    // Until then (a chunk that begins inside of a string literal or a comment)
+    // tokens are re-lexed one by one from the last known position.
+    std::vector<Token> tokens = std::move(chunks[0].tokens);
+    ChunkResult const *failure = chunks[0].is_failed ? &chunks[0] : nullptr;
+
+    LexerState state(source, literals);
+    state.index = tokens.empty() ? 0 : tokens.back().index + tokens.back().value.size();
+
+    bool is_finished = (nullptr != failure) || (!tokens.empty() && tokens.back().type == TokenType::t_eof);
+    std::size_t chunk = 1;
+
+    while (!is_finished)
+    {
+      auto token = get_next_token(state);
+
+      while (chunk + 1 < chunk_count && token.index >= bounds[chunk + 1])
+        ++chunk;
+
+      auto &candidates = chunks[chunk].tokens;
+      auto match = std::lower_bound(candidates.begin(), candidates.end(), token.index,
+                                    [](Token const &t, std::uint64_t index) { return t.index < index; });
+
+      if (match != candidates.end() && match->index == token.index && match->type == token.type)
+      {
+        for (auto adopted = match; adopted != candidates.end(); ++adopted)
+          tokens.push_back(adopt(*adopted, chunks[chunk], literals));
+        if (chunks[chunk].is_failed)
+        {
+          failure = &chunks[chunk];
+          break;
+        }
+
+        state.index = tokens.back().index + tokens.back().value.size();
+        is_finished = tokens.back().type == TokenType::t_eof;
+        ++chunk;
+        continue;
+      }
+
+      tokens.push_back(token);
+      is_finished = state.is_error_occurred() || token.type == TokenType::t_eof;
+    }
+
+    if (nullptr != failure)
+    {
+      state.index = failure->error_index;
+      state.error.code = failure->error_code;
+      state.error.message = failure->error_message;
+    }
+
+    if (state.is_error_occurred())
+    {
+      log_error(state);
+      tokens.push_back(make_eof_token(state.index));
+    }
+
+    if (nullptr != failed)
+      *failed = state.is_error_occurred();
+    return tokens;
+  }
+}
@@ -1,19 +1,14 @@
-#include <memory>
-
 #include "parsing.hpp"
 
 
 namespace akbit::system::parsing
 {
-  Token ParserState::consume(TokenType const type, TokenSubType const subtype)
+  Token const &ParserState::consume(TokenType const type, TokenSubType const subtype)
   {
-    Token tok = this->peek();
+    Token const &tok = this->peek();
     if (type != tok.type || (subtype != TokenSubType::t_unknown && subtype != tok.sub_type))
     {
-      std::string expected = (subtype != TokenSubType::t_unknown ? get_sub_type_name(subtype) : get_type_name(type));
-      this->error.code = error_t::p_unexpected_token;
-      this->error.message = "[somewhere]: <" + expected + "> expected, but <"
-      + get_sub_type_name(tok.sub_type) + "> was given";
+      this->fail(type, subtype);
       return tok;
     }
 
@@ -21,31 +16,12 @@ namespace akbit::system::parsing
     return tok;
   }
 
-  Token ParserState::consume(TokenSubType const subtype)
+  Token const &ParserState::consume(TokenSubType const subtype)
   {
-    Token tok = this->peek();
+    Token const &tok = this->peek();
     if (subtype != tok.sub_type)
     {
-      std::string expected = get_sub_type_name(subtype);
-      this->error.code = error_t::p_unexpected_token;
-      this->error.message = "[somewhere]: <" + expected + "> expected, but <"
-      + get_sub_type_name(tok.sub_type) + ">(" + tok.value +  ") was given";
-      return tok;
-    }
-
-    this->move();
-    return tok;
-  }
-
-  Token ParserState::consume(TokenSubType const subtype, std::string const value)
-  {
-    Token tok = this->peek();
-    if (subtype != tok.sub_type || tok.value != value)
-    {
-      std::string expected = get_sub_type_name(subtype);
-      this->error.code = error_t::p_unexpected_token;
-      this->error.message = "[somewhere]: <" + expected + ">(" + value + ") expected, but <"
-      + get_sub_type_name(tok.sub_type) + ">(" + tok.value +  ") was given";
+      this->fail(TokenType::t_unknown, subtype);
       return tok;
     }
 
@@ -56,28 +32,127 @@ namespace akbit::system::parsing
 
   namespace
   {
+    /// Operator of every sub-type of operator tokens, the lexer has already
+    /// told the operators apart, so their spelling is not looked at again
+    constexpr auto operator_of_sub_type = [] {
+      std::array<operator_id_t, static_cast<std::size_t>(TokenSubType::t_eof) + 1> ids{};
+      auto set = [&](TokenSubType sub_type, operator_id_t id) { ids[static_cast<std::size_t>(sub_type)] = id; };
+
+      set(TokenSubType::t_dot,                    op_member_access);
+      set(TokenSubType::t_caret,                  op_power);
+      set(TokenSubType::t_star,                   op_multiplication);
+      set(TokenSubType::t_slash,                  op_division);
+      set(TokenSubType::t_percent,                op_modulus);
+      set(TokenSubType::t_plus,                   op_addition);
+      set(TokenSubType::t_dash,                   op_subtraction);
+      set(TokenSubType::t_greater_equal,          op_greater_equal);
+      set(TokenSubType::t_less_equal,             op_less_equal);
+      set(TokenSubType::t_brace_triangular_right, op_greater);
+      set(TokenSubType::t_brace_triangular_left,  op_less);
+      set(TokenSubType::t_double_equal,           op_equal);
+      set(TokenSubType::t_not_equal,              op_not_equal);
+      set(TokenSubType::t_ampersand,              op_bitwise_and);
+      set(TokenSubType::t_vertical_bar,           op_bitwise_or);
+      set(TokenSubType::t_double_ampersand,       op_logical_and);
+      set(TokenSubType::t_double_vertical_bar,    op_logical_or);
+      set(TokenSubType::t_arrow,                  op_lambda);
+      set(TokenSubType::t_comma,                  op_tuple);
+      set(TokenSubType::t_colon,                  op_type_cast);
+      set(TokenSubType::t_equal,                  op_assignment);
+      return ids;
+    }();
+
+    operator_t const & peek_operator(ParserState &state);
     operator_t const & parse_operator(ParserState &state);
 
-    std::shared_ptr<Node> parse_module(ParserState &state);
+    Node * parse_module(ParserState &state);
 
     // Node * parse_function_declaration(ParserState &state);
 
-    std::shared_ptr<Node> parse_expression(ParserState &state);
-    std::shared_ptr<Node> parse_expression(std::shared_ptr<Node> left_operand, ParserState &state, uint32_t base_priority);
+    /// Rules of the grammar that contain other rules.
+    /// They are run on a stack of frames on the heap rather than by
+    /// recursion, so any depth of nesting in the source can be parsed
+    enum rule_t : std::uint8_t
+    {
+      r_statement,
+      r_statement_or_composite_unit,
+      r_statement_declaration,
+      r_statement_condition,
+      r_expression,
+      /// Operators after the left operand, see parse_expression_tail
+      r_expression_tail,
+      r_composite_unit,
+      r_unit,
+    };
+
+    /// Locals of a rule that is being parsed
+    struct frame_t
+    {
+      rule_t rule;
+      /// Where the rule goes on after the rule it has called returns
+      std::uint8_t step;
+      /// Node being built, the left operand for expressions
+      Node * node;
+      /// Right operand of an expression, type placeholder of a declaration
+      Node * operand;
+      operator_t const * operation;
+      std::uint32_t base_priority;
+      /// Innermost function of the chain of `->` that `node` is, if it is one
+      Node * tail;
+    };
+
+    struct RuleStack
+    {
+      ParserState &state;
+      /// The innermost rule is at the back
+      std::vector<frame_t> &frames;
+      /// Value of the rule that has returned last
+      Node * result;
+      /// Tail of the result if it is a chain of `->`, it goes along
+      /// with the result through the rules that return it as it is
+      Node * result_tail;
+
+      /// Runs the rule before the current one goes on;
+      /// the reference to the current frame is not valid after that
+      inline void call(rule_t rule, Node * node = nullptr, std::uint32_t base_priority = 0)
+      {
+        frames.push_back({ rule, 0, node, nullptr, nullptr, base_priority, tail_of(node) });
+      }
+
+      inline void ret(Node * value)
+      {
+        result_tail = (value == result ? result_tail : (value == frames.back().node ? frames.back().tail : nullptr));
+        result = value;
+        frames.pop_back();
+      }
 
-    std::shared_ptr<Node> parse_statement(ParserState &state);
+      inline Node * tail_of(Node * node) const noexcept
+      {
+        return (nullptr != node && node == result ? result_tail : nullptr);
+      }
+    };
 
-    std::shared_ptr<Node> parse_statement_declaration(ParserState &state);
-    std::shared_ptr<Node> parse_statement_condition(ParserState &state);
+    Node * parse_rule(ParserState &state, std::vector<frame_t> &frames, rule_t rule);
 
-    std::shared_ptr<Node> parse_composite_unit(ParserState &state);
-    std::shared_ptr<Node> parse_unit(ParserState &state);
-    std::shared_ptr<Node> parse_value(ParserState &state);
+    void parse_statement_declaration(RuleStack &rules, frame_t &frame);
+    void parse_statement_condition(RuleStack &rules, frame_t &frame);
+    void parse_expression(RuleStack &rules, frame_t &frame);
+    void parse_expression_tail(RuleStack &rules, frame_t &frame);
+    void parse_composite_unit(RuleStack &rules, frame_t &frame);
+    void parse_unit(RuleStack &rules, frame_t &frame);
+    Node * parse_value(ParserState &state);
   }
 
-  std::shared_ptr<Node> parse(std::vector<Token> &tokens)
+
+  Node * parse(std::vector<Token> &tokens, LiteralPool const &literals, std::string_view source, Session &session)
   {
-    ParserState state(tokens);
+    TokenStream stream(tokens, literals);
+    return parse(stream, source, session);
+  }
+
+  Node * parse(TokenStream &tokens, std::string_view source, Session &session)
+  {
+    ParserState state(tokens, source, session);
     auto module = parse_module(state);
 
     if (state.is_failed())
@@ -87,41 +162,103 @@ namespace akbit::system::parsing
       return module;
     }
 
+    // A lexical error ends the tokens early, it is logged by the stream
+    std::get<Node::module_t>(module->value).has_errors = tokens.is_failed();
     return module;
   }
 
-  std::shared_ptr<Node> convert_to_tuple(std::shared_ptr<Node> node)
+
+  StatementParser::StatementParser(TokenStream &tokens_, std::string_view source_, Session &session_, bool fingerprints_)
+    : state(tokens_, source_, session_)
   {
-    if (nullptr == node) return nullptr;
-    try
-    {
-      std::get<Node::value_tuple_t>(node->value);
-      return node;
-    }
-    catch (...) { }
-    
-    auto container = std::make_shared<Node>(Node::value_tuple_t{
-      .entries = {
-        {node}
-      }
-    });
+    state.fingerprinting = fingerprints_;
+  }
+
+  bool StatementParser::next(Node * &statement)
+  {
+    if (state.is_eof() || state.is_failed())
+      return false;
+
+    if (state.fingerprinting)
+      state.fingerprint = fingerprint_basis;
+
+    std::vector<frame_t> frames;
+    statement = parse_rule(state, frames, r_statement);
 
-    return container;
+    if (state.is_failed())
+      log_error(state);
+    return true;
   }
 
 
   namespace
   {
-    std::shared_ptr<Node> parse_module(ParserState &state)
+    Node * convert_to_tuple(Node * node, Session &session)
+    {
+      if (nullptr == node) return nullptr;
+      if (node->is<Node::value_tuple_t>()) return node;
+
+      auto container = session.make<Node>(Node::value_tuple_t{
+        .entries = {
+          {node}
+        }
+      });
+
+      return container;
+    }
+
+    std::vector<Node *> convert_to_declarations(std::vector<Node *>& nodes, Session &session)
     {
-      auto container = std::make_shared<Node>(Node::module_t{
+      // TODO: Handle errors
+      std::vector<Node *> res;
+
+      for (auto&& n : nodes)
+      {
+        if (auto cast = n->as<Node::binary_operation_t>())
+        {
+          res.push_back(session.make<Node>(Node::declaration_t{
+            .variable = cast->operands[0],
+            .type = cast->operands[1],
+            .value = nullptr
+          }));
+        }
+        else
+        {
+          res.push_back(session.make<Node>(Node::declaration_t{
+            .variable = n,
+            .type = nullptr,
+            .value = nullptr
+          }));
+        }
+      }
+
+      return res;
+    }
+
+    /// Function taking the parameters described by the expression
+    Node * make_function(Session &session, Node * parameters, Node * body)
+    {
+      auto tuple = convert_to_tuple(parameters, session);
+      return session.make<Node>(Node::value_function_t{
+        .parameters = convert_to_declarations(tuple->as<Node::value_tuple_t>()->entries, session),
+        .body = body,
+        .owned_context = nullptr,
+      });
+    }
+
+    Node * parse_module(ParserState &state)
+    {
+      auto container = state.session.make<Node>(Node::module_t{
         .data = {},
         .has_errors = false,
       });
 
+      // Frames are kept between the statements to reuse their memory
+      std::vector<frame_t> frames;
+
       while (!state.is_eof() && !state.is_failed())
       {
-        std::get<Node::module_t>(container->value).data.push_back(parse_statement(state));
+        std::get<Node::module_t>(container->value).data.push_back(parse_rule(state, frames, r_statement));
 
         if (state.is_failed())
           return container;
@@ -130,334 +267,408 @@ namespace akbit::system::parsing
       return container;
     }
 
-    std::shared_ptr<Node> parse_statement(ParserState &state)
+    Node * parse_rule(ParserState &state, std::vector<frame_t> &frames, rule_t rule)
     {
-      if (state.peek().sub_type == TokenSubType::t_identifier && state.peek().value == "let")
-        return parse_statement_declaration(state);
-      else if (state.peek().sub_type == TokenSubType::t_identifier && state.peek().value == "if")
-        return parse_statement_condition(state);
-      return parse_expression(state);
-    }
+      RuleStack rules{ state, frames, nullptr, nullptr };
+      rules.call(rule);
 
-    std::shared_ptr<Node> parse_statement(std::shared_ptr<Node> left_operand, ParserState &state, uint32_t base_priority)
-    {
-      if (state.peek().sub_type == TokenSubType::t_identifier && state.peek().value == "let")
-        return parse_statement_declaration(state);
-      else if (state.peek().sub_type == TokenSubType::t_identifier && state.peek().value == "if")
-        return parse_statement_condition(state);
-      return parse_expression(left_operand, state, base_priority);
-    }
+      while (!frames.empty())
+      {
+        auto &frame = frames.back();
+        switch (frame.rule)
+        {
+          case r_statement:
+          case r_statement_or_composite_unit:
+            switch (state.peek().sub_type)
+            {
+              case TokenSubType::t_keyword_let: frame.rule = r_statement_declaration; break;
+              case TokenSubType::t_keyword_if:  frame.rule = r_statement_condition;   break;
+              default: frame.rule = (frame.rule == r_statement ? r_expression : r_composite_unit); break;
+            }
+            break;
+
+          case r_statement_declaration: parse_statement_declaration(rules, frame); break;
+          case r_statement_condition:   parse_statement_condition(rules, frame);   break;
+          case r_expression:            parse_expression(rules, frame);            break;
+          case r_expression_tail:       parse_expression_tail(rules, frame);       break;
+          case r_composite_unit:        parse_composite_unit(rules, frame);        break;
+          case r_unit:                  parse_unit(rules, frame);                  break;
+        }
+      }
 
-    std::shared_ptr<Node> parse_statement_or_composite_unit(ParserState &state)
-    {
-      if (state.peek().sub_type == TokenSubType::t_identifier && state.peek().value == "let")
-        return parse_statement_declaration(state);
-      else if (state.peek().sub_type == TokenSubType::t_identifier && state.peek().value == "if")
-        return parse_statement_condition(state);
-      return parse_composite_unit(state);
+      return rules.result;
     }
 
-    std::shared_ptr<Node> parse_statement_declaration(ParserState &state)
+    void parse_statement_declaration(RuleStack &rules, frame_t &frame)
     {
-      state.consume(TokenSubType::t_identifier, "let");
-      if (state.is_failed()) return nullptr;
-
-      auto container = std::make_shared<Node>(Node::declaration_t{});
-      auto idt = state.consume(TokenType::t_identifier);
-      if (state.is_failed()) return container;
-
-      std::get<Node::declaration_t>(container->value).variable = std::make_shared<Node>(Node(Node::value_variable_t{
-        .name = idt.value,
-      }));
-      auto unode = std::make_shared<Node>();
-      auto data = parse_expression(unode, state, 2);
-      if (data != unode)
+      auto &state = rules.state;
+      switch (frame.step)
       {
-        if (data->value.index() == 5 && std::get<Node::binary_operation_t>(data->value).operation == find_operator(":"))
+        case 0:
         {
-          data = std::get<Node::binary_operation_t>(data->value).operands[1];
+          state.consume(TokenSubType::t_keyword_let);
+          if (state.is_failed()) return rules.ret(nullptr);
+
+          frame.node = state.session.make<Node>(Node::declaration_t{});
+          auto const &idt = state.consume(TokenType::t_identifier);
+          if (state.is_failed()) return rules.ret(frame.node);
+
+          std::get<Node::declaration_t>(frame.node->value).variable = state.session.make<Node>(Node::value_variable_t{
+            .name = idt.literal,
+          });
+          frame.operand = state.session.make<Node>();
+          frame.step = 1;
+          return rules.call(r_expression_tail, frame.operand, 2);
         }
-        else
+
+        case 1:
         {
-          data = unode;
+          auto data = rules.result;
+          if (data != frame.operand)
+          {
+            auto cast = data->as<Node::binary_operation_t>();
+            if (cast && cast->operation->id == op_type_cast)
+            {
+              data = cast->operands[1];
+            }
+            else
+            {
+              data = frame.operand;
+            }
+          }
+          std::get<Node::declaration_t>(frame.node->value).type = data;
+
+          state.consume(TokenSubType::t_equal);
+          if (state.is_failed()) return rules.ret(frame.node);
+
+          frame.step = 2;
+          return rules.call(r_statement);
         }
+
+        default:
+          std::get<Node::declaration_t>(frame.node->value).value = rules.result;
+          return rules.ret(frame.node);
       }
-      std::get<Node::declaration_t>(container->value).type = data;
+    }
 
-      state.consume(TokenSubType::t_equal);
-      if (state.is_failed()) return container;
+    void parse_statement_condition(RuleStack &rules, frame_t &frame)
+    {
+      auto &state = rules.state;
+      switch (frame.step)
+      {
+        case 0:
+          state.consume(TokenSubType::t_keyword_if);
+          if (state.is_failed()) return rules.ret(nullptr);
+          frame.node = state.session.make<Node>(Node::condition_t{});
+          frame.step = 1;
+          return rules.call(r_statement);
+
+        case 1:
+          std::get<Node::condition_t>(frame.node->value).expression = rules.result;
+          if (state.is_failed()) return rules.ret(frame.node);
+          state.consume(TokenSubType::t_keyword_then);
+          if (state.is_failed()) return rules.ret(frame.node);
+          frame.step = 2;
+          return rules.call(r_statement);
+
+        case 2:
+          std::get<Node::condition_t>(frame.node->value).clause_true = rules.result;
+          if (state.is_failed()) return rules.ret(frame.node);
+
+          if (state.peek().sub_type != TokenSubType::t_keyword_else)
+            return rules.ret(frame.node);
+          state.move();
+          frame.step = 3;
+          return rules.call(r_statement);
 
-      std::get<Node::declaration_t>(container->value).value = parse_statement(state);
-      return container;
+        default:
+          std::get<Node::condition_t>(frame.node->value).clause_false = rules.result;
+          return rules.ret(frame.node);
+      }
     }
 
-    std::shared_ptr<Node> parse_statement_condition(ParserState &state)
+    void parse_expression(RuleStack &rules, frame_t &frame)
     {
-      state.consume(TokenSubType::t_identifier, "if");
-      if (state.is_failed()) return nullptr;
-      auto container = std::make_shared<Node>(Node::condition_t{});
-      auto &cc = std::get<Node::condition_t>(container->value);
-      cc.expression = parse_statement(state);
-      if (state.is_failed()) return container;
-      state.consume(TokenSubType::t_identifier, "then");
-      if (state.is_failed()) return container;
-      cc.clause_true = parse_statement(state);
-      if (state.is_failed()) return container;
-
-      state.save();
-      state.consume(TokenSubType::t_identifier, "else");
-      if (state.is_failed())
+      if (frame.step == 0)
       {
-        state.restore();
-        return container;
+        frame.step = 1;
+        return rules.call(r_composite_unit);
       }
-      state.drop();
-      cc.clause_false = parse_statement(state);
-      return container;
+
+      if (rules.state.is_failed())
+        return rules.ret(rules.result);
+
+      // The operators are parsed in place of this rule
+      frame = { r_expression_tail, 0, rules.result, nullptr, nullptr, 0, rules.result_tail };
     }
 
-    std::shared_ptr<Node> parse_expression(ParserState &state)
+    /// `a -> b -> c` is a function of `a` returning a function of `b`.
+    /// When the left operand is a chain already, its innermost body
+    /// becomes the parameter of a new innermost function
+    /// \param tail innermost function of the left operand if it is a chain,
+    ///             receives the one of the result
+    Node * combine_lambda(ParserState &state, Node * left_operand, Node * right_operand, Node *&tail)
     {
-      std::shared_ptr<Node> left_operand = parse_composite_unit(state);
-
-      if (state.is_failed())
+      if (nullptr != tail && left_operand->is<Node::value_function_t>())
+      {
+        auto &body = tail->as<Node::value_function_t>()->body;
+        body = make_function(state.session, body, right_operand);
+        tail = body;
         return left_operand;
+      }
 
-      return parse_expression(left_operand, state, 0);
+      tail = make_function(state.session, left_operand, right_operand);
+      return tail;
     }
 
-    std::shared_ptr<Node> parse_expression(std::shared_ptr<Node> left_operand, ParserState &state, uint32_t base_priority)
+    /// `a, b, c` is a tuple. Only chains of `,` make tuples
+    /// of two entries and more, so such a tuple on the left continues
+    Node * combine_tuple(Session &session, Node * left_operand, Node * right_operand)
     {
-      state.save();
-      operator_t const * operation = &parse_operator(state);
-      if (operation == &operator_unknown || operation->precedence < base_priority)
+      auto tuple = left_operand->as<Node::value_tuple_t>();
+      if (tuple && tuple->entries.size() >= 2)
       {
-        state.restore();
+        tuple->entries.push_back(right_operand);
         return left_operand;
       }
-      state.drop();
 
-      std::shared_ptr<Node> right_operand = parse_statement_or_composite_unit(state);
-      if (state.is_failed())
+      return session.make<Node>(Node::value_tuple_t{
+        .entries = { left_operand, right_operand },
+      });
+    }
+
+    /// Appends the operand to the left operand if it is already an operation
+    /// of the same operator, so that chains like `a + b + c` are n-ary nodes.
+    /// Functions and tuples are built here, the tree has no `->` or `,` operations
+    Node * combine(ParserState &state, Node * left_operand, Node * right_operand, operator_t const *operation, Node *&tail)
+    {
+      if (operation->id == op_lambda)
+        return combine_lambda(state, left_operand, right_operand, tail);
+      if (operation->id == op_tuple)
+        return combine_tuple(state.session, left_operand, right_operand);
+
+      auto chain = left_operand->as<Node::binary_operation_t>();
+      if (chain && chain->operation == operation)
+      {
+        chain->operands.push_back(right_operand);
         return left_operand;
+      }
 
-      // Get next operator
-      state.save();
-      operator_t const * next_operation = &parse_operator(state);
-      if (state.is_failed()) { state.restore(); }
-      else state.drop();
+      return make_node_bop(state.session, left_operand, right_operand, operation);
+    }
+
+    // Precedence climbing: an operator is consumed only after its
+    // precedence has been checked, so no token is ever read twice.
+    // The first operator is taken at `base_priority` and above,
+    // the following ones only above it
+    void parse_expression_tail(RuleStack &rules, frame_t &frame)
+    {
+      auto &state = rules.state;
+      operator_t const * next_operation = &operator_unknown;
 
-      while (next_operation->precedence > base_priority)
+      switch (frame.step)
       {
-          if (next_operation->precedence > operation->precedence)
+        case 0:
+          frame.operation = &peek_operator(state);
+          if (frame.operation == &operator_unknown || frame.operation->precedence < frame.base_priority)
+            return rules.ret(frame.node);
+          state.move();
+
+          frame.step = 1;
+          return rules.call(r_statement_or_composite_unit);
+
+        case 1:
+          frame.operand = rules.result;
+          if (state.is_failed())
+            return rules.ret(frame.node);
+
+          next_operation = &peek_operator(state);
+          if (next_operation->precedence > frame.base_priority && next_operation->precedence > frame.operation->precedence)
           {
             // If the following operator has the higher priority
             // parse that subexpression first
-            state.index -= next_operation->representation.size();
-            right_operand = parse_statement(right_operand, state, operation->precedence);
-            if (state.is_failed())
-              return left_operand;
-
-            state.save();
-            next_operation = &parse_operator(state);
-            if (state.is_failed()) { state.restore(); break; }
-            else state.drop();
-
-            if (next_operation->precedence <= base_priority)
-              break;
+            frame.step = 2;
+            return rules.call(r_expression_tail, frame.operand, frame.operation->precedence);
           }
+          break;
 
-          if (left_operand->value.index() == 5 && std::get<Node::binary_operation_t>(left_operand->value).operation == operation)
-          {
-            std::get<Node::binary_operation_t>(left_operand->value).operands.push_back(right_operand);
-          }
-          else
-          {
-            left_operand = make_node_bop(left_operand, right_operand, operation);
-          }
-
-          operation = next_operation;
-
-          right_operand = parse_statement_or_composite_unit(state);
+        default:
+          frame.operand = rules.result;
           if (state.is_failed())
-            return left_operand;
+            return rules.ret(frame.node);
 
-          state.save();
-          next_operation = &parse_operator(state);
-          if (state.is_failed()) { state.restore(); break; }
-          else state.drop();
+          next_operation = &peek_operator(state);
+          break;
       }
 
-      if (next_operation->precedence <= base_priority)
-        state.index -= next_operation->representation.size();
-
-      if (left_operand->value.index() == 5 && std::get<Node::binary_operation_t>(left_operand->value).operation == operation)
-      {
-        std::get<Node::binary_operation_t>(left_operand->value).operands.push_back(right_operand);
-      }
-      else
+      if (next_operation->precedence <= frame.base_priority)
       {
-        left_operand = make_node_bop(left_operand, right_operand, operation);
+        frame.node = combine(state, frame.node, frame.operand, frame.operation, frame.tail);
+        return rules.ret(frame.node);
       }
 
-      return left_operand;
+      frame.node = combine(state, frame.node, frame.operand, frame.operation, frame.tail);
+      frame.operation = next_operation;
+      state.move();
+
+      frame.step = 1;
+      return rules.call(r_statement_or_composite_unit);
     }
 
-    std::shared_ptr<Node> parse_composite_unit(ParserState &state)
+    void parse_composite_unit(RuleStack &rules, frame_t &frame)
     {
-      auto unit = parse_unit(state);
-      if (state.is_failed()) return unit;
+      auto &state = rules.state;
+      switch (frame.step)
+      {
+        case 0:
+          frame.step = 1;
+          return rules.call(r_unit);
+
+        case 1:
+          frame.node = rules.result;
+          if (state.is_failed()) return rules.ret(frame.node);
+          break;
+
+        default:
+          frame.node = state.session.make<Node>(Node::function_call_t{
+            .expression = frame.node,
+            .arguments = convert_to_tuple(rules.result, state.session)
+          });
+          break;
+      }
 
       // Function calls
-      while (state.peek().sub_type == TokenSubType::t_brace_round_left)
+      if (state.peek().sub_type == TokenSubType::t_brace_round_left)
       {
-        auto container = std::make_shared<Node>(Node::function_call_t{
-          .expression = unit,
-          .arguments = parse_unit(state)
-        });
-        unit = container;
+        frame.step = 2;
+        return rules.call(r_unit);
       }
 
-      return unit;
+      return rules.ret(frame.node);
     }
 
-    std::shared_ptr<Node> parse_unit(ParserState &state)
+    void parse_unit(RuleStack &rules, frame_t &frame)
     {
-      if (state.peek().sub_type == TokenSubType::t_brace_round_left)
+      auto &state = rules.state;
+      switch (frame.step)
       {
-        state.move();
-        if (state.peek().sub_type == TokenSubType::t_brace_round_right)
-        {
-          auto container = std::make_shared<Node>(Node::value_tuple_t{
-            .entries = {},
-          });
-          state.move();
-          return container;
-        }
+        case 0:
+          if (state.peek().sub_type == TokenSubType::t_brace_round_left)
+          {
+            state.move();
+            if (state.peek().sub_type == TokenSubType::t_brace_round_right)
+            {
+              auto container = state.session.make<Node>(Node::value_tuple_t{
+                .entries = {},
+              });
+              state.move();
+              return rules.ret(container);
+            }
+
+            frame.step = 1;
+            return rules.call(r_statement);
+          }
 
-        auto res = parse_statement(state);
-        if (not state.is_failed())
-          state.consume(TokenSubType::t_brace_round_right);
-        return res;
-      }
+          if (state.peek().sub_type == TokenSubType::t_brace_curly_left)
+          {
+            state.move();
+            frame.node = state.session.make<Node>(Node::block_t{
+              .code = {},
+            });
+            break;
+          }
 
-      if (state.peek().sub_type == TokenSubType::t_brace_curly_left)
-      {
-        state.move();
-        auto container = std::make_shared<Node>(Node::block_t{
-          .code = {},
-        });
+          if (state.peek().sub_type == TokenSubType::t_dash || state.peek().sub_type == TokenSubType::t_plus)
+          {
+            frame.operation = &parse_operator(state);
+            frame.step = 3;
+            return rules.call(r_composite_unit);
+          }
 
-        while (!state.is_eof() && !state.is_failed() && state.peek().sub_type != TokenSubType::t_brace_curly_right)
+          return rules.ret(parse_value(state));
+
+        case 1:
         {
-          auto line = parse_statement(state);
-          std::get<Node::block_t>(container->value).code.push_back(line);
+          auto res = rules.result;
+          if (not state.is_failed())
+            state.consume(TokenSubType::t_brace_round_right);
+          return rules.ret(res);
         }
-        
-        if (!state.is_failed())
-          state.consume(TokenSubType::t_brace_curly_right);
 
-        return container;
+        case 2:
+          std::get<Node::block_t>(frame.node->value).code.push_back(rules.result);
+          break;
+
+        default:
+          return rules.ret(state.session.make<Node>(Node::unary_operation_t{
+            .operation = frame.operation,
+            .expression = rules.result,
+          }));
       }
 
-      if (state.peek().sub_type == TokenSubType::t_dash || state.peek().sub_type == TokenSubType::t_plus)
+      // Statements of a block
+      if (!state.is_eof() && !state.is_failed() && state.peek().sub_type != TokenSubType::t_brace_curly_right)
       {
-        auto container = std::make_shared<Node>(Node::unary_operation_t{
-          .operation = &parse_operator(state),
-          .expression = parse_composite_unit(state),
-        });
-        return container;
+        frame.step = 2;
+        return rules.call(r_statement);
       }
 
-      return parse_value(state);
+      if (!state.is_failed())
+        state.consume(TokenSubType::t_brace_curly_right);
+
+      return rules.ret(frame.node);
     }
 
-    std::shared_ptr<Node> parse_value(ParserState &state)
+    Node * parse_value(ParserState &state)
     {
-      Token tok;
-      auto container = std::make_shared<Node>();
+      auto const &tok = state.peek();
+      Node * container;
 
+      switch (tok.sub_type)
       {
-        state.save();
-        tok = state.consume(TokenSubType::t_integer);
-        if (not state.is_failed())
-        {
-          state.drop();
-          container->value = Node::value_integer_t({ .value = tok.value });
-          return container;
-        }
-        state.restore();
-      }
+        case TokenSubType::t_integer:
+          container = state.session.make<Node>(Node::value_integer_t{ .value = std::string(tok.value) });
+          break;
 
-      {
-        state.save();
-        tok = state.consume(TokenSubType::t_decimal);
-        if (not state.is_failed())
-        {
-          state.drop();
-          container->value = Node::value_decimal_t({ .value = tok.value });
-          return container;
-        }
-        state.restore();
-      }
+        case TokenSubType::t_decimal:
+          container = state.session.make<Node>(Node::value_decimal_t{ .value = std::string(tok.value) });
+          break;
 
-      {
-        state.save();
-        tok = state.consume(TokenSubType::t_identifier);
-        if (not state.is_failed())
-        {
-          state.drop();
-          container->value = Node::value_variable_t({ .name = tok.value });
-          return container;
-        }
-        state.restore();
-      }
+        case TokenSubType::t_identifier:
+          container = state.session.make<Node>(Node::value_variable_t{ .name = tok.literal, .record = {} });
+          break;
 
-      {
-        state.save();
-        tok = state.consume(TokenSubType::t_string);
-        if (not state.is_failed())
-        {
-          state.drop();
-          container->value = Node::value_string_t({ .value = tok.value });
-          return container;
-        }
-        state.drop();
+        case TokenSubType::t_string:
+          container = state.session.make<Node>(Node::value_string_t{ .value = std::string(state.tokens.literals().text(tok)) });
+          break;
+
+        case TokenSubType::t_character:
+          container = state.session.make<Node>(Node::value_character_t{ .value = tok.literal });
+          break;
+
+        default:
+          state.fail(TokenType::t_unknown, TokenSubType::t_unknown);
+          return state.session.make<Node>();
       }
-      
+
+      state.move();
       return container;
     }
 
-    operator_t const & parse_operator(ParserState &state)
+    operator_t const & peek_operator(ParserState &state)
     {
-      state.save();
-      Token t = state.consume(TokenType::t_operator);
-      if (state.is_failed())
-      {
-        state.drop();
+      if (state.peek().type != TokenType::t_operator)
         return operator_unknown;
-      }
-      state.restore();
 
-      operator_t const * operation = &operator_unknown;
-      std::string representation = "";
-      state.save();
+      return operators_list[operator_of_sub_type[static_cast<std::size_t>(state.peek().sub_type)]];
+    }
 
-      while (state.peek().type == TokenType::t_operator && representation.size() < 5)
-      {
-        representation += state.peek().value;
+    operator_t const & parse_operator(ParserState &state)
+    {
+      auto &operation = peek_operator(state);
+      if (&operation != &operator_unknown)
         state.move();
-
-        for (std::size_t index = 0; index < operators_list.size(); ++index)
-          if (operators_list[index].representation == representation)
-            operation = &operators_list[index];
-      }
-
-      state.restore();
-      for (std::size_t i = 0; i < operation->representation.size(); ++i)
-          state.move();
-
-      return *operation;
+      return operation;
     }
   }
 }
@@ -9,8 +9,10 @@
 
 #include "../error_handling.hpp"
 #include "lexing.hpp"
+#include "token_stream.hpp"
 #include "../operators.hpp"
 #include "../node.hpp"
+#include "../session.hpp"
 
 
 namespace akbit::system::parsing
@@ -18,58 +20,109 @@ namespace akbit::system::parsing
   struct ParserState
   {
   public:
-    std::vector<Token> &tokens;
+    TokenStream &tokens;
+    std::string_view source;
+    /// Owns the nodes of the tree being built
+    Session &session;
     std::size_t index;
 
+    /// Hash of the tokens moved past, kept only while `fingerprinting` is set
+    bool fingerprinting = false;
+    std::uint64_t fingerprint = 0;
+
+    /// Only what is needed to describe the error later,
+    /// the message is formatted by log_error() if it is printed at all
     struct error_info_t
     {
       error_t code;
-      std::string message;
+      /// Expected kind of token, t_unknown if any value was expected
+      TokenType expected_type;
+      TokenSubType expected_sub_type;
+      /// Index of the unexpected token
+      std::size_t token;
     } error;
 
-  private:
-    std::vector<std::size_t> saves;
-
   public:
-    ParserState(std::vector<Token> &tokens_)
+    ParserState(TokenStream &tokens_, std::string_view source_, Session &session_)
       : tokens(tokens_)
+      , source(source_)
+      , session(session_)
       , index(0)
-      , error{error_t::e_no_errors, ""}
-      , saves()
+      , error{error_t::e_no_errors, TokenType::t_unknown, TokenSubType::t_unknown, 0}
     { }
 
 
-    inline bool is_eof() const noexcept { return index >= tokens.size() - 1; }
+    inline bool is_eof() const noexcept { return peek().type == TokenType::t_eof; }
     inline bool is_failed() const noexcept { return error.code != error_t::e_no_errors; }
 
 
-    inline Token peek() const noexcept { return tokens[index]; }
+    /// Tokens are viewed in the stream, a reference stays valid
+    /// until the parser moves past the token after it
+    inline Token const &peek() const noexcept { return tokens.at(index); }
 
     inline void move() noexcept
     {
-      if (index < tokens.size())
+      if (!is_eof())
+      {
+        if (fingerprinting)
+          fingerprint = parsing::fingerprint(fingerprint, peek());
         ++index;
+      }
+
+      // The parser never looks back, the stream keeps only the current
+      // token and the one consume() has just returned
+      tokens.release(index > 0 ? index - 1 : 0);
     }
 
-    Token consume(TokenType const type, TokenSubType const subtype=TokenSubType::t_unknown);
-    Token consume(TokenSubType const subtype);
-    Token consume(TokenSubType const subtype, std::string const value);
+    Token const &consume(TokenType const type, TokenSubType const subtype=TokenSubType::t_unknown);
+    Token const &consume(TokenSubType const subtype);
 
-    inline void save() { saves.push_back(index); }
-    inline void drop() { saves.pop_back(); }
-    inline void restore()
+    /// Stops parsing at the current token
+    inline void fail(TokenType const type, TokenSubType const subtype) noexcept
     {
-      index = saves[saves.size() - 1];
-      error.code = error_t::e_no_errors;
-      error.message = "";
-      saves.pop_back();
+      error = { error_t::p_unexpected_token, type, subtype, index };
     }
 
 
     friend void ::akbit::system::log_error(ParserState &state);
   };
 
-  std::shared_ptr<Node> parse(std::vector<Token> &tokens);
+  /// Parses the statements of a module one at a time,
+  /// so that each of them can be compiled and dropped before the next one
+  class StatementParser
+  {
+  public:
+    /// \param session_ owns the nodes of the statements,
+    ///                 it can be reset once a statement is done
+    /// \param fingerprints_ whether the tokens of every statement are hashed
+    StatementParser(TokenStream &tokens_, std::string_view source_, Session &session_, bool fingerprints_ = false);
+
+  public:
+    /// \param statement receives the next statement, nullptr for an empty one.
+    ///                  After a syntax error it is what was parsed of the
+    ///                  statement, the error is logged and it is the last one
+    /// \return false once there are no more statements
+    bool next(Node * &statement);
+
+    /// \return whether there was a syntax error or a lexical one
+    inline bool is_failed() const noexcept { return state.is_failed() || state.tokens.is_failed(); }
+
+    /// \return first token of the next statement, the tokens
+    ///         and the text before it are not read again
+    inline Token const &lookahead() const noexcept { return state.peek(); }
+
+    /// \return hash of the tokens of the last statement, equal statements
+    ///         have equal ones whatever the space and commentaries in them.
+    ///         0 unless the parser was asked for fingerprints
+    inline std::uint64_t fingerprint() const noexcept { return state.fingerprint; }
+
+  private:
+    ParserState state;
+  };
+
+  /// \param session owns the nodes of the returned tree
+  Node * parse(TokenStream &tokens, std::string_view source, Session &session);
+  Node * parse(std::vector<Token> &tokens, LiteralPool const &literals, std::string_view source, Session &session);
 }
 
 #endif
@@ -0,0 +1,310 @@
+#include <algorithm>
+
+#include "relexing.hpp"
+#include "../error_handling.hpp"
+
+
+namespace akbit::system::parsing
+{
+  namespace
+  {
+    /// Offset the lexer starts reading a token at,
+    /// character literals report the offset after their quote
+    std::uint64_t token_start(Token const &token)
+    {
+      return token.type == TokenType::t_character ? token.index - 1 : token.index;
+    }
+  }
+
+  EditedTokens::EditedTokens(std::string_view source_, LiteralPool &literals_)
+    : source(source_)
+    , literals(&literals_)
+  {
+    lex_all();
+  }
+
+  void EditedTokens::lex_all()
+  {
+    auto all = tokenize(source, *literals);
+
+    chunks.clear();
+    std::vector<std::int64_t> bases;
+    for (std::size_t first = 0; first < all.size(); first += chunk_capacity)
+    {
+      auto last = std::min(all.size(), first + chunk_capacity);
+      auto chunk_base = static_cast<std::int64_t>(all[first].index);
+
+      chunk_t chunk;
+      chunk.reserve(last - first);
+      for (auto i = first; i < last; ++i)
+        chunk.push_back({ static_cast<std::int64_t>(all[i].index) - chunk_base, all[i].value.size(), all[i].type, all[i].sub_type, all[i].literal });
+
+      chunks.push_back(std::move(chunk));
+      bases.push_back(chunk_base);
+    }
+
+    rebuild(bases);
+    stats = { all.size(), 0 };
+  }
+
+  void EditedTokens::apply(std::string_view source_, TextEdit const &edit)
+  {
+    std::uint64_t old_size = source_.size() + edit.removed - edit.inserted.size();
+    source = source_;
+
+    // Lexing of the old text has stopped on an error, nothing can be reused
+    auto &last = chunks.back().back();
+    if (last.type != TokenType::t_eof || end_of(last, base(chunks.size() - 1)) != old_size)
+    {
+      lex_all();
+      return;
+    }
+
+    // The token ending at the edit could be extended by it (`ab` + `c`),
+    // so the first token to re-lex is the first one ending at or after the edit.
+    // Tokens before it were lexed without looking at the edited bytes
+    auto restart = lower_bound(edit.offset, end_of);
+    auto from = std::uint64_t(0);
+    if (restart.slot > 0)
+      from = end_of(chunks[restart.chunk][restart.slot - 1], base(restart.chunk));
+    else if (restart.chunk > 0)
+      from = end_of(chunks[restart.chunk - 1].back(), base(restart.chunk - 1));
+
+    LexerState state(source, *literals);
+    state.index = from;
+
+    std::uint64_t edit_end = edit.offset + edit.inserted.size();
+    auto by = static_cast<std::int64_t>(edit.inserted.size()) - static_cast<std::int64_t>(edit.removed);
+
+    std::vector<Token> fresh;
+    position_t reused{ chunks.size(), 0 };
+
+    while (true)
+    {
+      auto token = get_next_token(state);
+
+      if (state.is_error_occurred())
+      {
+        fresh.push_back(token);
+        log_error(state);
+        fresh.push_back(make_eof_token(state.index));
+        break;
+      }
+
+      // Past the edit the texts are equal, so a token starting at the same
+      // place as an old one is that token and so is everything after it.
+      // The chunks have not moved yet, they are searched at the old offsets
+      if (token_start(token) >= edit_end)
+      {
+        auto old_start = static_cast<std::uint64_t>(static_cast<std::int64_t>(token_start(token)) - by);
+        auto match = lower_bound(old_start, start_of);
+
+        if (match.chunk < chunks.size())
+        {
+          auto &old = chunks[match.chunk][match.slot];
+          if (start_of(old, base(match.chunk)) == old_start && old.type == token.type)
+          {
+            reused = match;
+            break;
+          }
+        }
+      }
+
+      fresh.push_back(token);
+      if (token.type == TokenType::t_eof)
+        break;
+    }
+
+    stats = { fresh.size(), 0 };
+
+    // The fresh tokens replace the old ones in the chunk of the first of them.
+    // Kept tokens of that chunk are moved within it, the chunks after it
+    // are moved as a whole
+    auto &chunk = chunks[restart.chunk];
+    auto chunk_base = base(restart.chunk);
+
+    chunk_t tail;
+    if (reused.chunk == restart.chunk)
+    {
+      tail.assign(chunk.begin() + reused.slot, chunk.end());
+      for (auto &stored : tail)
+        stored.offset += by;
+      stats.moved = tail.size();
+    }
+
+    chunk.resize(restart.slot);
+    for (auto &token : fresh)
+      chunk.push_back({ static_cast<std::int64_t>(token.index) - chunk_base, token.value.size(), token.type, token.sub_type, token.literal });
+    chunk.insert(chunk.end(), tail.begin(), tail.end());
+
+    if (reused.chunk == restart.chunk)
+    {
+      if (restart.chunk + 1 < chunks.size())
+        shift(restart.chunk + 1, by);
+    }
+    else if (reused.chunk < chunks.size())
+    {
+      auto &rest = chunks[reused.chunk];
+      rest.erase(rest.begin(), rest.begin() + reused.slot);
+      stats.moved = rest.size();
+      shift(reused.chunk, by);
+    }
+
+    // Chunks between the two were lexed again
+    auto last_touched = std::min(reused.chunk, chunks.size() - 1);
+    for (auto i = restart.chunk + 1; i < reused.chunk && i < chunks.size(); ++i)
+      chunks[i].clear();
+
+    balance(restart.chunk, last_touched);
+  }
+
+  std::vector<Token> EditedTokens::tokens() const
+  {
+    std::vector<Token> all;
+    for (std::size_t i = 0; i < chunks.size(); ++i)
+    {
+      auto chunk_base = base(i);
+      for (auto &stored : chunks[i])
+        all.push_back(materialize(stored, chunk_base));
+    }
+    return all;
+  }
+
+  std::vector<Token> EditedTokens::tokens(std::uint64_t begin, std::uint64_t end) const
+  {
+    std::vector<Token> found;
+    for (auto position = lower_bound(begin, start_of); position.chunk < chunks.size(); ++position.chunk, position.slot = 0)
+    {
+      auto chunk_base = base(position.chunk);
+      auto &chunk = chunks[position.chunk];
+      for (; position.slot < chunk.size(); ++position.slot)
+      {
+        if (start_of(chunk[position.slot], chunk_base) >= end)
+          return found;
+        found.push_back(materialize(chunk[position.slot], chunk_base));
+      }
+    }
+    return found;
+  }
+
+  std::uint64_t EditedTokens::start_of(stored_t const &token, std::int64_t base) noexcept
+  {
+    auto index = static_cast<std::uint64_t>(base + token.offset);
+    return token.type == TokenType::t_character ? index - 1 : index;
+  }
+
+  std::uint64_t EditedTokens::end_of(stored_t const &token, std::int64_t base) noexcept
+  {
+    auto index = static_cast<std::uint64_t>(base + token.offset);
+    return token.type == TokenType::t_eof ? index : index + token.length;
+  }
+
+  std::int64_t EditedTokens::base(std::size_t chunk) const noexcept
+  {
+    std::int64_t sum = 0;
+    for (auto i = chunk + 1; i > 0; i -= i & (0 - i))
+      sum += starts[i];
+    return sum;
+  }
+
+  void EditedTokens::shift(std::size_t chunk, std::int64_t by) noexcept
+  {
+    for (auto i = chunk + 1; i < starts.size(); i += i & (0 - i))
+      starts[i] += by;
+  }
+
+  void EditedTokens::rebuild(std::vector<std::int64_t> const &bases)
+  {
+    starts.assign(bases.size() + 1, 0);
+    for (std::size_t i = 0; i < bases.size(); ++i)
+      starts[i + 1] = bases[i] - (i > 0 ? bases[i - 1] : 0);
+
+    for (std::size_t i = 1; i < starts.size(); ++i)
+    {
+      auto parent = i + (i & (0 - i));
+      if (parent < starts.size())
+        starts[parent] += starts[i];
+    }
+  }
+
+  template <typename Key>
+  EditedTokens::position_t EditedTokens::lower_bound(std::uint64_t value, Key key) const
+  {
+    // Chunks are never empty, the one to look in is the first
+    // whose last token is not below the value
+    std::size_t low = 0;
+    std::size_t high = chunks.size();
+    while (low < high)
+    {
+      auto middle = low + (high - low) / 2;
+      if (key(chunks[middle].back(), base(middle)) < value)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+
+    if (low == chunks.size())
+      return { chunks.size(), 0 };
+
+    auto chunk_base = base(low);
+    auto &chunk = chunks[low];
+    auto slot = std::partition_point(chunk.begin(), chunk.end(),
+                                     [&](stored_t const &stored) { return key(stored, chunk_base) < value; });
+    return { low, static_cast<std::size_t>(slot - chunk.begin()) };
+  }
+
+  Token EditedTokens::materialize(stored_t const &stored, std::int64_t base) const
+  {
+    auto index = static_cast<std::uint64_t>(base + stored.offset);
+    return Token{
+      index,
+      (stored.type == TokenType::t_eof ? eof_spelling : source.substr(index, stored.length)),
+      stored.type, stored.sub_type,
+      stored.literal
+    };
+  }
+
+  void EditedTokens::balance(std::size_t first, std::size_t last)
+  {
+    bool is_balanced = true;
+    for (auto i = first; i <= last; ++i)
+      is_balanced = is_balanced && !chunks[i].empty() && chunks[i].size() <= 2 * chunk_capacity;
+    if (is_balanced)
+      return;
+
+    // Chunks are added or removed only after as many tokens have been
+    // lexed, so placing all of them again is paid for by those tokens
+    std::vector<chunk_t> balanced;
+    std::vector<std::int64_t> bases;
+    for (std::size_t i = 0; i < chunks.size(); ++i)
+    {
+      auto chunk_base = base(i);
+      if (i < first || i > last || chunks[i].size() <= 2 * chunk_capacity)
+      {
+        if (chunks[i].empty())
+          continue;
+        balanced.push_back(std::move(chunks[i]));
+        bases.push_back(chunk_base);
+        continue;
+      }
+
+      auto &chunk = chunks[i];
+      for (std::size_t piece = 0; piece < chunk.size(); piece += chunk_capacity)
+      {
+        auto end = std::min(chunk.size(), piece + chunk_capacity);
+        auto offset = chunk[piece].offset;
+
+        chunk_t part(chunk.begin() + piece, chunk.begin() + end);
+        for (auto &stored : part)
+          stored.offset -= offset;
+        stats.moved += part.size();
+
+        balanced.push_back(std::move(part));
+        bases.push_back(chunk_base + offset);
+      }
+    }
+
+    chunks = std::move(balanced);
+    rebuild(bases);
+  }
+}
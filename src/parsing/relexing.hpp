@@ -0,0 +1,132 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__PARSING__RELEXING_HPP
+#define AKBIT__SYSTEM__PARSING__RELEXING_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "lexing.hpp"
+#include "literals.hpp"
+
+
+namespace akbit::system::parsing
+{
+  /// Replacement of a byte range of a text
+  struct TextEdit
+  {
+    /// Offset of the replaced range in the text before the edit
+    std::uint64_t offset;
+    /// Length of the replaced range
+    std::uint64_t removed;
+    /// Text that replaces the range
+    std::string_view inserted;
+  };
+
+  /// Tokens of a text that is edited over and over, e.g. in an editor.
+  /// Tokens are kept in chunks with offsets relative to their chunk and
+  /// without their spelling; the chunks find where they start through a tree
+  /// of their shifts. An edit re-lexes and rewrites only the tokens around it,
+  /// the chunks after it are moved by a single update of the tree
+  class EditedTokens
+  {
+  public:
+    /// What the last edit has cost
+    struct edit_stats_t
+    {
+      /// Tokens lexed again
+      std::size_t lexed = 0;
+      /// Tokens kept but written again, e.g. the rest of the edited chunk
+      std::size_t moved = 0;
+    };
+
+  public:
+    /// Lexes the whole text
+    /// \param source_ text followed by `source_padding` zero bytes
+    /// \param literals_ receives the decoded text of string literals
+    ///                  and the names of identifiers, for every edit
+    EditedTokens(std::string_view source_, LiteralPool &literals_);
+
+  public:
+    /// Updates the tokens after the text was edited.
+    /// Lexing restarts at the last token boundary before the edit and stops as
+    /// soon as a new token lines up with an old one past the edit; the other
+    /// tokens are not lexed again. After a lexical error the whole text is
+    /// lexed again by the next edit
+    /// \param source_ the edited text, followed by `source_padding` zero bytes
+    /// \param edit the edit that produced the text
+    void apply(std::string_view source_, TextEdit const &edit);
+
+    /// \return the tokens that tokenize() returns for the current text,
+    ///         but for the ids of literals lexed again
+    std::vector<Token> tokens() const;
+
+    /// \return the tokens that start in [begin, end) of the current text
+    std::vector<Token> tokens(std::uint64_t begin, std::uint64_t end) const;
+
+    inline edit_stats_t const & last_edit() const noexcept { return stats; }
+
+  private:
+    /// Token without its spelling, placed relative to its chunk
+    struct stored_t
+    {
+      std::int64_t offset;
+      std::uint64_t length;
+      TokenType type;
+      TokenSubType sub_type;
+      std::uint32_t literal;
+    };
+
+    /// Token of a chunk, chunks.size() for the end of the tokens
+    struct position_t
+    {
+      std::size_t chunk;
+      std::size_t slot;
+    };
+
+    using chunk_t = std::vector<stored_t>;
+
+    /// Chunks are split when they grow past twice this many tokens
+    static constexpr std::size_t chunk_capacity = 512;
+
+  private:
+    /// Offset the lexer starts reading the token at,
+    /// character literals report the offset after their quote
+    static std::uint64_t start_of(stored_t const &token, std::int64_t base) noexcept;
+    /// Offset the lexer continues from after the token
+    static std::uint64_t end_of(stored_t const &token, std::int64_t base) noexcept;
+
+    void lex_all();
+
+    /// \return offset the chunk starts from
+    std::int64_t base(std::size_t chunk) const noexcept;
+    /// Moves the chunk and every chunk after it
+    void shift(std::size_t chunk, std::int64_t by) noexcept;
+    /// Places the chunks at the offsets after chunks have been added or removed
+    void rebuild(std::vector<std::int64_t> const &bases);
+
+    /// \param key offset of a stored token, growing along the tokens
+    /// \return first token whose key is not less than the value
+    template <typename Key>
+    position_t lower_bound(std::uint64_t value, Key key) const;
+
+    Token materialize(stored_t const &stored, std::int64_t base) const;
+    /// Splits chunks that hold too many tokens and drops empty ones
+    void balance(std::size_t first, std::size_t last);
+
+  private:
+    std::string_view source;
+    LiteralPool *literals;
+
+    std::vector<chunk_t> chunks;
+    /// Fenwick tree over the differences between the starts of neighbouring chunks
+    std::vector<std::int64_t> starts;
+
+    edit_stats_t stats;
+  };
+}
+
+#endif
@@ -0,0 +1,157 @@
+#include <cstring>
+
+#include "scanning.hpp"
+#include "../utf8.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AKBIT__SYSTEM__SCANNING_X86 1
+#include <emmintrin.h>
+#include "scanning_kernels.hpp"
+#endif
+
+
+namespace akbit::system::parsing
+{
+  namespace
+  {
+    template <std::uint8_t classes>
+    char const *skip_class_scalar(char const *position)
+    {
+      while (has_class(*position, classes))
+        ++position;
+      return position;
+    }
+
+    char const *skip_line_scalar(char const *position)
+    {
+      while (*position != '\n' && *position != '\0')
+        ++position;
+      return position;
+    }
+
+    char const *skip_string_body_scalar(char const *position)
+    {
+      while (*position != '"' && *position != '\\' && *position != '\0' && !has_class(*position, cc_non_ascii))
+        ++position;
+      return position;
+    }
+
+    std::uint64_t find_invalid_utf8_scalar(char const *text, std::uint64_t size)
+    {
+      std::uint64_t offset = 0;
+      while (offset < size)
+      {
+        std::uint64_t words[utf8_block_size / 8];
+        std::memcpy(words, text + offset, sizeof(words));
+
+        std::uint64_t non_ascii = 0;
+        for (auto word : words)
+          non_ascii |= word;
+
+        if ((non_ascii & 0x8080808080808080ull) == 0)
+        {
+          offset += utf8_block_size;
+          continue;
+        }
+
+        auto next = validate_utf8_block(text, offset, size);
+        if (next < offset + utf8_block_size && next < size)
+          return next;
+        offset = next;
+      }
+
+      return size;
+    }
+  }
+
+  std::uint64_t validate_utf8_block(char const *text, std::uint64_t offset, std::uint64_t size)
+  {
+    std::uint64_t end = offset + utf8_block_size;
+    while (offset < end && offset < size)
+    {
+      if (static_cast<unsigned char>(text[offset]) < 0x80u)
+      {
+        ++offset;
+        continue;
+      }
+
+      std::uint32_t code_point;
+      auto length = decode_utf8(text + offset, size - offset, code_point);
+      if (length == 0)
+        return offset;
+      offset += length;
+    }
+
+    return offset;
+  }
+
+  ScanKernels const &get_scalar_scan_kernels()
+  {
+    static ScanKernels const kernels{
+      skip_class_scalar<cc_whitespace>,
+      skip_class_scalar<cc_identifier>,
+      skip_class_scalar<cc_digit>,
+      skip_line_scalar,
+      skip_string_body_scalar,
+      find_invalid_utf8_scalar,
+      "scalar",
+    };
+    return kernels;
+  }
+}
+
+
+#ifdef AKBIT__SYSTEM__SCANNING_X86
+
+namespace akbit::system::parsing
+{
+  namespace
+  {
+    struct Sse2
+    {
+      using vector_t = __m128i;
+      using mask_t = std::uint32_t;
+      static constexpr std::size_t width = 16;
+      static constexpr mask_t full = 0xFFFFu;
+
+      static vector_t load(char const *p) { return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p)); }
+      static vector_t equal(vector_t v, char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); }
+      static vector_t either(vector_t a, vector_t b) { return _mm_or_si128(a, b); }
+      static vector_t lower(vector_t v) { return _mm_or_si128(v, _mm_set1_epi8(0x20)); }
+      static vector_t non_ascii(vector_t v) { return _mm_cmplt_epi8(v, _mm_setzero_si128()); }
+      static mask_t bits(vector_t v) { return static_cast<mask_t>(_mm_movemask_epi8(v)); }
+
+      static vector_t in_range(vector_t v, char low, char count)
+      {
+        auto shifted = _mm_xor_si128(_mm_sub_epi8(v, _mm_set1_epi8(low)), _mm_set1_epi8(static_cast<char>(0x80)));
+        return _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(0x80 + count)));
+      }
+    };
+  }
+
+  ScanKernels const &get_scan_kernels()
+  {
+    static ScanKernels const &selected = []() -> ScanKernels const & {
+      static constexpr ScanKernels sse2 = make_vector_scan_kernels<Sse2>("sse2");
+
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2")) return get_avx2_scan_kernels();
+      if (__builtin_cpu_supports("sse2")) return sse2;
+      return get_scalar_scan_kernels();
+    }();
+
+    return selected;
+  }
+}
+
+#else
+
+namespace akbit::system::parsing
+{
+  ScanKernels const &get_scan_kernels()
+  {
+    return get_scalar_scan_kernels();
+  }
+}
+
+#endif
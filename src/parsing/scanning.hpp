@@ -0,0 +1,94 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__SCANNING_HPP
+#define AKBIT__SYSTEM__SCANNING_HPP
+
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace akbit::system::parsing
+{
+  /// Classes of source characters, a character may belong to several of them.
+  /// Unlike <cctype> predicates the classes do not depend on the locale
+  enum CharacterClass : std::uint8_t
+  {
+    cc_none             = 0,
+
+    cc_whitespace       = 1 << 0,
+    cc_control          = 1 << 1,
+    cc_digit            = 1 << 2,
+    cc_identifier_start = 1 << 3,
+    cc_identifier       = 1 << 4,
+    cc_non_ascii        = 1 << 5,
+  };
+
+  constexpr std::array<std::uint8_t, 256> character_classes = [] {
+    std::array<std::uint8_t, 256> table{};
+
+    for (int c = 0; c < 32; ++c)
+      table[c] |= cc_control;
+    table[127] |= cc_control;
+
+    for (char c : { ' ', '\t', '\n', '\v', '\f', '\r' })
+      table[static_cast<unsigned char>(c)] |= cc_whitespace;
+
+    for (int c = '0'; c <= '9'; ++c)
+      table[c] |= cc_digit | cc_identifier;
+
+    for (int c = 'a'; c <= 'z'; ++c)
+      table[c] |= cc_identifier_start | cc_identifier;
+    for (int c = 'A'; c <= 'Z'; ++c)
+      table[c] |= cc_identifier_start | cc_identifier;
+    for (char c : { '_', '$' })
+      table[static_cast<unsigned char>(c)] |= cc_identifier_start | cc_identifier;
+
+    for (int c = 128; c < 256; ++c)
+      table[c] |= cc_non_ascii;
+
+    return table;
+  }();
+
+  constexpr inline bool has_class(char c, std::uint8_t classes) noexcept
+  { return (character_classes[static_cast<unsigned char>(c)] & classes) != 0; }
+
+
+  /// Run-skipping kernels used by the lexer.
+  /// Every kernel returns a pointer to the first character that does not belong to the run.
+  /// Kernels read whole vectors past that point, so the text has to be followed
+  /// by `source_padding` zero bytes; '\0' never belongs to a run and stops every scan
+  struct ScanKernels
+  {
+    char const *(*skip_whitespace)(char const *position);
+    char const *(*skip_identifier)(char const *position);
+    char const *(*skip_digits)(char const *position);
+
+    /// Stops at '\n' or '\0'
+    char const *(*skip_line)(char const *position);
+    /// Stops at '"', '\\', '\0' or a byte outside of ASCII
+    char const *(*skip_string_body)(char const *position);
+
+    /// Checks `utf8_block_size` bytes at once while they are ASCII
+    /// \return offset of the first byte that does not start a valid UTF-8 sequence or `size`
+    std::uint64_t (*find_invalid_utf8)(char const *text, std::uint64_t size);
+
+    char const *name;
+  };
+
+  constexpr std::size_t utf8_block_size = 32;
+
+  /// Slow path of find_invalid_utf8, validates the sequences that start inside of a block
+  /// \return offset of the first invalid sequence inside of the block,
+  ///         otherwise offset of the first sequence after the block
+  std::uint64_t validate_utf8_block(char const *text, std::uint64_t offset, std::uint64_t size);
+
+  /// Scalar kernels, available on every target
+  ScanKernels const &get_scalar_scan_kernels();
+
+  /// Best kernels supported by the running processor (AVX2, SSE2 or scalar)
+  ScanKernels const &get_scan_kernels();
+}
+
+#endif
@@ -0,0 +1,44 @@
+// This unit is compiled with AVX2 enabled, its kernels are only
+// reachable through get_scan_kernels() after a processor check.
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#include "scanning_kernels.hpp"
+
+
+namespace akbit::system::parsing
+{
+  namespace
+  {
+    struct Avx2
+    {
+      using vector_t = __m256i;
+      using mask_t = std::uint32_t;
+      static constexpr std::size_t width = 32;
+      static constexpr mask_t full = 0xFFFFFFFFu;
+
+      static vector_t load(char const *p) { return _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)); }
+      static vector_t equal(vector_t v, char c) { return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)); }
+      static vector_t either(vector_t a, vector_t b) { return _mm256_or_si256(a, b); }
+      static vector_t lower(vector_t v) { return _mm256_or_si256(v, _mm256_set1_epi8(0x20)); }
+      static vector_t non_ascii(vector_t v) { return _mm256_cmpgt_epi8(_mm256_setzero_si256(), v); }
+      static mask_t bits(vector_t v) { return static_cast<mask_t>(_mm256_movemask_epi8(v)); }
+
+      static vector_t in_range(vector_t v, char low, char count)
+      {
+        auto shifted = _mm256_xor_si256(_mm256_sub_epi8(v, _mm256_set1_epi8(low)), _mm256_set1_epi8(static_cast<char>(0x80)));
+        return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(0x80 + count)), shifted);
+      }
+    };
+  }
+
+  ScanKernels const &get_avx2_scan_kernels()
+  {
+    static constexpr ScanKernels kernels = make_vector_scan_kernels<Avx2>("avx2");
+    return kernels;
+  }
+}
+
+#endif
@@ -0,0 +1,135 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__SCANNING_KERNELS_HPP
+#define AKBIT__SYSTEM__SCANNING_KERNELS_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+
+#include "scanning.hpp"
+
+
+// Vector kernels shared by the SSE2 and AVX2 translation units.
+// Each unit provides a `Vector` type with the primitives below and instantiates
+// the kernels with its own instruction set enabled, so the templates are kept
+// in an unnamed namespace and never shared between units.
+//
+// A byte is inside [low, low + count) when (byte - low) is below `count` as an
+// unsigned number; SSE2 and AVX2 only compare signed bytes, so `in_range`
+// flips the sign bit of both sides.
+namespace akbit::system::parsing
+{
+  namespace
+  {
+    template <class V> struct Whitespace
+    {
+      static typename V::vector_t test(typename V::vector_t v)
+      { return V::either(V::equal(v, ' '), V::in_range(v, '\t', 5)); }
+    };
+
+    template <class V> struct Digits
+    {
+      static typename V::vector_t test(typename V::vector_t v)
+      { return V::in_range(v, '0', 10); }
+    };
+
+    template <class V> struct Identifier
+    {
+      static typename V::vector_t test(typename V::vector_t v)
+      {
+        auto letters = V::in_range(V::lower(v), 'a', 26);
+        auto digits = V::in_range(v, '0', 10);
+        auto special = V::either(V::equal(v, '_'), V::equal(v, '$'));
+        return V::either(letters, V::either(digits, special));
+      }
+    };
+
+    template <class V> struct LineEnd
+    {
+      static typename V::vector_t test(typename V::vector_t v)
+      { return V::either(V::equal(v, '\n'), V::equal(v, '\0')); }
+    };
+
+    template <class V> struct StringEnd
+    {
+      static typename V::vector_t test(typename V::vector_t v)
+      {
+        auto special = V::either(V::equal(v, '"'), V::equal(v, '\\'));
+        return V::either(special, V::either(V::equal(v, '\0'), V::non_ascii(v)));
+      }
+    };
+
+
+    /// Skips while the test holds for every byte of a vector
+    template <class V, template <class> class Test>
+    inline char const *skip_while(char const *position)
+    {
+      while (true)
+      {
+        auto mask = V::bits(Test<V>::test(V::load(position)));
+        if (mask != V::full)
+          return position + __builtin_ctz(~mask);
+        position += V::width;
+      }
+    }
+
+    /// Skips until the test holds for some byte of a vector
+    template <class V, template <class> class Test>
+    inline char const *skip_until(char const *position)
+    {
+      while (true)
+      {
+        auto mask = V::bits(Test<V>::test(V::load(position)));
+        if (mask != 0)
+          return position + __builtin_ctz(mask);
+        position += V::width;
+      }
+    }
+
+    template <class V>
+    std::uint64_t find_invalid_utf8(char const *text, std::uint64_t size)
+    {
+      std::uint64_t offset = 0;
+      while (offset < size)
+      {
+        // Sign bits of the bytes are set only outside of ASCII
+        typename V::mask_t non_ascii = 0;
+        for (std::size_t step = 0; step < utf8_block_size; step += V::width)
+          non_ascii |= V::bits(V::load(text + offset + step));
+
+        if (non_ascii == 0)
+        {
+          offset += utf8_block_size;
+          continue;
+        }
+
+        auto next = validate_utf8_block(text, offset, size);
+        if (next < offset + utf8_block_size && next < size)
+          return next;
+        offset = next;
+      }
+
+      return size;
+    }
+
+    template <class V>
+    constexpr ScanKernels make_vector_scan_kernels(char const *name)
+    {
+      return ScanKernels{
+        skip_while<V, Whitespace>,
+        skip_while<V, Identifier>,
+        skip_while<V, Digits>,
+        skip_until<V, LineEnd>,
+        skip_until<V, StringEnd>,
+        find_invalid_utf8<V>,
+        name,
+      };
+    }
+  }
+
+  /// Defined in scanning_avx2.cpp, the only unit compiled with AVX2 enabled
+  ScanKernels const &get_avx2_scan_kernels();
+}
+
+#endif
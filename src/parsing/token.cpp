@@ -6,6 +6,8 @@
 
 namespace akbit::system::parsing
 {
+  std::string_view const eof_spelling = "##EOF##";
+
   std::string get_type_name(TokenType type)
   {
     using tt = TokenType;
@@ -14,6 +16,7 @@ namespace akbit::system::parsing
     {
       case tt::t_commentary: return "commentary";
       case tt::t_identifier: return "identifier";
+      case tt::t_keyword: return "keyword";
       case tt::t_character: return "character";
       case tt::t_string: return "string";
       case tt::t_number: return "number";
@@ -33,6 +36,10 @@ namespace akbit::system::parsing
       case tst::t_multiline_commentary: return "comment/multiline";
 
       case tst::t_identifier: return "identifier";
+      case tst::t_keyword_let: return "keyword/let";
+      case tst::t_keyword_if: return "keyword/if";
+      case tst::t_keyword_then: return "keyword/then";
+      case tst::t_keyword_else: return "keyword/else";
       case tst::t_integer: return "number/integer";
       case tst::t_decimal: return "number/decimal";
       case tst::t_string: return "string";
@@ -71,6 +78,14 @@ namespace akbit::system::parsing
       case tst::t_colon: return "op/colon";
       case tst::t_semicolon: return "op/semicolon";
 
+      case tst::t_greater_equal: return "op/greater_equal";
+      case tst::t_less_equal: return "op/less_equal";
+      case tst::t_double_equal: return "op/double_equal_sign";
+      case tst::t_not_equal: return "op/not_equal";
+      case tst::t_double_ampersand: return "op/double_ampersand";
+      case tst::t_double_vertical_bar: return "op/double_vertical_bar";
+      case tst::t_arrow: return "op/arrow";
+
       case tst::t_eof: return "end_of_file";
 
       case tst::t_unknown: return "#???";
@@ -81,7 +96,7 @@ namespace akbit::system::parsing
 
   std::ostream &operator<<(std::ostream &out, parsing::Token &token)
   {
-    out << std::setw(4) << token.line << '|' << std::setw(4) << token.column << ' '
+    out << std::setw(8) << token.index << ' '
         << std::setw(24) << get_sub_type_name(token.sub_type) << "  "
         << token.value;
     return out;
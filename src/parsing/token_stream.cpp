@@ -0,0 +1,64 @@
+#include <cassert>
+
+#include "token_stream.hpp"
+#include "../error_handling.hpp"
+
+
+namespace akbit::system::parsing
+{
+  Token const &TokenStream::at(std::size_t index)
+  {
+    if (nullptr != tokens)
+      return (*tokens)[index < tokens->size() ? index : tokens->size() - 1];
+
+    assert(index >= first && "token was already released");
+
+    while (index >= first + count && !is_finished)
+      pull();
+
+    if (index >= first + count)
+      index = first + count - 1;
+
+    return ring[index & (ring.size() - 1)];
+  }
+
+  void TokenStream::release(std::size_t index) noexcept
+  {
+    if (nullptr != tokens)
+      return;
+
+    // The last token is kept, so that the end of the stream stays reachable
+    while (first < index && count > 1)
+      ++first, --count;
+  }
+
+  void TokenStream::pull()
+  {
+    auto token = get_next_token(*lexer);
+    push(token);
+
+    if (lexer->is_error_occurred())
+    {
+      log_error(*lexer);
+      push(make_eof_token(lexer->index));
+      failed = true;
+    }
+
+    is_finished = ring[(first + count - 1) & (ring.size() - 1)].type == TokenType::t_eof;
+  }
+
+  void TokenStream::push(Token const &token)
+  {
+    if (count == ring.size())
+    {
+      // Indices map onto slots by their low bits, so entries have to be redistributed
+      std::vector<Token> larger(ring.size() * 2);
+      for (std::size_t i = first; i < first + count; ++i)
+        larger[i & (larger.size() - 1)] = ring[i & (ring.size() - 1)];
+      ring.swap(larger);
+    }
+
+    ring[(first + count) & (ring.size() - 1)] = token;
+    ++count;
+  }
+}
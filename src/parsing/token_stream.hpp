@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__TOKEN_STREAM_HPP
+#define AKBIT__SYSTEM__TOKEN_STREAM_HPP
+
+
+#include <cstddef>
+#include <vector>
+
+#include "lexing.hpp"
+
+
+namespace akbit::system::parsing
+{
+  /// Token source of the parser.
+  /// Either serves an already materialized token vector or pulls tokens
+  /// from a lexer on demand. In the streaming mode only the tokens the parser
+  /// may still revisit are kept, in a ring buffer that grows only when the
+  /// parser looks further back than it ever did before.
+  /// Both modes end with a single t_eof token which is repeated on overrun.
+  class TokenStream
+  {
+  public:
+    /// \param tokens_ tokens ending with a t_eof token, as returned by tokenize()
+    /// \param literals_ the pool the tokens were lexed with
+    /// \param failed_ whether lexing has stopped at an error
+    TokenStream(std::vector<Token> const &tokens_, LiteralPool const &literals_, bool failed_ = false)
+      : tokens(&tokens_)
+      , lexer(nullptr)
+      , pool(&literals_)
+      , ring{}
+      , first(0), count(0)
+      , is_finished(true)
+      , failed(failed_)
+    { }
+
+    /// \param lexer_ lexer to pull tokens from, lexical errors are logged by the stream
+    TokenStream(LexerState &lexer_)
+      : tokens(nullptr)
+      , lexer(&lexer_)
+      , pool(lexer_.literals)
+      , ring(initial_capacity)
+      , first(0), count(0)
+      , is_finished(false)
+      , failed(false)
+    { }
+
+  public:
+    /// Gets a token by its absolute index.
+    /// The reference stays valid until the next call that lexes new tokens
+    /// \param index token index, not below the last released one
+    /// \return token or the t_eof token if the index lies past the end
+    Token const &at(std::size_t index);
+
+    /// Allows the stream to drop tokens before the index
+    void release(std::size_t index) noexcept;
+
+    /// Decoded text of the string literals of the stream
+    inline LiteralPool const &literals() const noexcept { return *pool; }
+
+    /// \return whether the tokens end early at a lexical error,
+    ///         known once the stream has reached its t_eof token
+    inline bool is_failed() const noexcept { return failed; }
+
+  private:
+    void pull();
+    void push(Token const &token);
+
+  private:
+    static constexpr std::size_t initial_capacity = 16;
+
+    std::vector<Token> const *tokens;
+    LexerState *lexer;
+    LiteralPool const *pool;
+
+    std::vector<Token> ring;
+    std::size_t first, count;
+    bool is_finished;
+    bool failed;
+  };
+}
+
+#endif
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <iomanip>
+
+#include "pipeline.hpp"
+#include "traversal.hpp"
+
+
+namespace akbit::system
+{
+  Pipeline::Pipeline(Session &session_, Node * const &root_, bool count_nodes_)
+    : session(session_)
+    , root(root_)
+    , count_nodes(count_nodes_)
+  { }
+
+  void Pipeline::add(Pass pass)
+  {
+    passes.push_back(std::move(pass));
+  }
+
+  void Pipeline::skip(std::string_view name)
+  {
+    skipped.emplace_back(name);
+  }
+
+  void Pipeline::stop_after(std::string_view name)
+  {
+    last = name;
+  }
+
+  std::size_t Pipeline::find(std::string_view name) const noexcept
+  {
+    std::size_t index = 0;
+    while (index < passes.size() && passes[index].name != name)
+      ++index;
+    return index;
+  }
+
+  bool Pipeline::schedule(std::vector<std::vector<std::size_t>> &steps, std::ostream &errors) const
+  {
+    std::vector<bool> needed(passes.size(), last.empty());
+
+    if (!last.empty())
+    {
+      auto index = find(last);
+      if (index == passes.size())
+      {
+        errors << "Unknown pass '" << last << "'" << std::endl;
+        return false;
+      }
+
+      // Dependencies are added before the passes that need them,
+      // so a single sweep towards the front finds all of them
+      needed[index] = true;
+      for (auto i = index + 1; i --> 0;)
+      {
+        if (!needed[i]) continue;
+        for (auto &dependency : passes[i].dependencies)
+        {
+          auto d = find(dependency);
+          if (d < i) needed[d] = true;
+        }
+      }
+    }
+
+    for (auto &name : skipped)
+    {
+      auto index = find(name);
+      if (index == passes.size())
+      {
+        errors << "Unknown pass '" << name << "'" << std::endl;
+        return false;
+      }
+      needed[index] = false;
+    }
+
+    for (std::size_t i = 0; i < passes.size(); ++i)
+    {
+      if (!needed[i]) continue;
+      for (auto &dependency : passes[i].dependencies)
+      {
+        auto d = find(dependency);
+        if (d >= i)
+        {
+          errors << "Pass '" << passes[i].name << "' depends on '" << dependency << "', which is not added before it" << std::endl;
+          return false;
+        }
+        if (!needed[d])
+        {
+          errors << "Pass '" << passes[i].name << "' needs '" << dependency << "', which is skipped" << std::endl;
+          return false;
+        }
+      }
+    }
+
+    // A per-node pass joins the walk of an earlier one
+    // if everything it depends on has run before that walk
+    constexpr auto unscheduled = ~static_cast<std::size_t>(0);
+    std::vector<std::size_t> step_of(passes.size(), unscheduled);
+    auto is_ready = [&](Pass const &pass) {
+      for (auto &dependency : pass.dependencies)
+        if (step_of[find(dependency)] >= steps.size())
+          return false;
+      return true;
+    };
+
+    for (std::size_t i = 0; i < passes.size(); ++i)
+    {
+      if (!needed[i] || step_of[i] != unscheduled) continue;
+
+      std::vector<std::size_t> step{ i };
+      if (passes[i].make_visitor)
+      {
+        for (auto j = i + 1; j < passes.size(); ++j)
+        {
+          if (needed[j] && passes[j].make_visitor && is_ready(passes[j]))
+          {
+            step_of[j] = steps.size();
+            step.push_back(j);
+          }
+        }
+      }
+
+      step_of[i] = steps.size();
+      steps.push_back(std::move(step));
+    }
+
+    return true;
+  }
+
+  bool Pipeline::run(std::ostream &errors)
+  {
+    using clock = std::chrono::steady_clock;
+
+    std::vector<std::vector<std::size_t>> steps;
+    if (!schedule(steps, errors))
+      return false;
+
+    for (auto &step : steps)
+    {
+      record_t record{ {}, {}, 0, 0 };
+      for (auto index : step)
+        record.name += (record.name.empty() ? "" : " + ") + passes[index].name;
+
+      auto allocated = session.allocated();
+      auto start = clock::now();
+
+      bool succeeded = true;
+      if (passes[step.front()].make_visitor)
+      {
+        std::vector<std::unique_ptr<NodePass>> owned;
+        std::vector<NodePass *> visitors;
+        for (auto index : step)
+        {
+          owned.push_back(passes[index].make_visitor());
+          visitors.push_back(owned.back().get());
+        }
+
+        walk(static_cast<Node const *>(root),
+          [&](Node const * node, std::size_t slot) {
+            for (auto visitor : visitors) visitor->enter(node, slot);
+          },
+          [&](Node const * node) {
+            for (auto visitor : visitors) visitor->leave(node);
+          });
+        for (auto visitor : visitors)
+          visitor->finish();
+      }
+      else
+      {
+        succeeded = passes[step.front()].run();
+      }
+
+      record.time = clock::now() - start;
+      record.allocated = session.allocated() - std::min(allocated, session.allocated());
+      if (count_nodes)
+        walk(static_cast<Node const *>(root), [&](Node const * node, std::size_t) { record.nodes += (nullptr != node); }, [](Node const *) { });
+      history.push_back(std::move(record));
+
+      if (!succeeded)
+        return false;
+    }
+
+    return true;
+  }
+
+  void Pipeline::report(std::ostream &out, std::vector<record_t> const &records, bool count_nodes)
+  {
+    auto milliseconds = [](std::chrono::steady_clock::duration time) {
+      return std::chrono::duration<double, std::milli>(time).count();
+    };
+
+    std::size_t width = 5;
+    for (auto &record : records)
+      width = std::max(width, record.name.size());
+
+    out << std::dec << std::fixed << std::setprecision(3) << std::left
+      << "Pass report:\n"
+      << "  " << std::setw(width) << "pass" << std::right
+      << std::setw(12) << "time (ms)" << std::setw(14) << "arena (KiB)" << std::setw(10) << "nodes" << '\n';
+
+    std::chrono::steady_clock::duration total_time{};
+    std::size_t total_allocated = 0;
+    for (auto &record : records)
+    {
+      out << "  " << std::left << std::setw(width) << record.name << std::right
+        << std::setw(12) << milliseconds(record.time)
+        << std::setw(14) << std::setprecision(1) << record.allocated / 1024.0 << std::setprecision(3);
+      if (count_nodes && record.nodes > 0) out << std::setw(10) << record.nodes;
+      else out << std::setw(10) << '-';
+      out << '\n';
+
+      total_time += record.time;
+      total_allocated += record.allocated;
+    }
+
+    out << "  " << std::left << std::setw(width) << "total" << std::right
+      << std::setw(12) << milliseconds(total_time)
+      << std::setw(14) << std::setprecision(1) << total_allocated / 1024.0 << std::endl;
+  }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__PIPELINE_HPP
+#define AKBIT__SYSTEM__PIPELINE_HPP
+
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "node.hpp"
+#include "session.hpp"
+
+
+namespace akbit::system
+{
+  /// Hooks of a pass that looks at the nodes of the tree one by one.
+  /// Such passes do not depend on each other, so several of them share
+  /// a single walk: every pass enters a node before the walk goes on
+  struct NodePass
+  {
+    virtual ~NodePass() = default;
+
+    /// Called before the children of the node
+    /// \param node nullptr for an optional child that is absent
+    /// \param slot position of the node among the children of its parent
+    virtual void enter(Node const * node, std::size_t slot) = 0;
+
+    /// Called after the children of the node
+    virtual void leave(Node const * node) { (void)node; }
+
+    /// Called once the whole tree has been walked
+    virtual void finish() { }
+  };
+
+
+  struct Pass
+  {
+    std::string name;
+    /// Names of the passes that have to run before this one,
+    /// they are added to the pipeline before it
+    std::vector<std::string> dependencies;
+
+    /// Runs over the whole compilation, returning false stops the pipeline
+    std::function<bool()> run = {};
+    /// Creates the hooks of a per-node pass right before the walk,
+    /// used instead of `run`
+    std::function<std::unique_ptr<NodePass>()> make_visitor = {};
+  };
+
+
+  /// Runs the passes of a compilation in the order they were added.
+  /// Per-node passes that can run at the same point share one walk
+  /// of the tree, a pass runs only if it is needed and not skipped
+  class Pipeline
+  {
+  public:
+    struct record_t
+    {
+      /// Names of the passes, joined by " + " for a shared walk
+      std::string name;
+      std::chrono::steady_clock::duration time;
+      /// Bytes allocated from the session
+      std::size_t allocated;
+      /// Nodes in the tree after the pass, 0 before there is a tree
+      std::size_t nodes;
+    };
+
+  public:
+    /// \param root tree walked by the per-node passes, read when they run
+    /// \param count_nodes whether the records get the size of the tree,
+    ///                    that takes an extra walk after every pass
+    Pipeline(Session &session_, Node * const &root_, bool count_nodes_);
+
+  public:
+    void add(Pass pass);
+
+    void skip(std::string_view name);
+    /// Only the pass and the ones it depends on are run
+    void stop_after(std::string_view name);
+
+    /// \param errors receives the reason if the pipeline can not be run
+    /// \return false if a pass has failed or the pipeline is not valid
+    bool run(std::ostream &errors);
+
+    /// Writes the time, allocations and tree size of every pass run
+    inline void report(std::ostream &out) const { report(out, history, count_nodes); }
+
+    /// Writes records gathered from one or more pipelines,
+    /// e.g. ones summed over several files
+    static void report(std::ostream &out, std::vector<record_t> const &records, bool count_nodes);
+
+    inline std::vector<record_t> const & records() const noexcept { return history; }
+
+  private:
+    /// \return index of the pass, passes.size() if there is none
+    std::size_t find(std::string_view name) const noexcept;
+
+    /// Fills `steps` with the indices of the passes to run in their order,
+    /// passes that share a walk are in the same step
+    bool schedule(std::vector<std::vector<std::size_t>> &steps, std::ostream &errors) const;
+
+  private:
+    Session &session;
+    Node * const &root;
+    bool count_nodes;
+
+    std::vector<Pass> passes;
+    std::vector<std::string> skipped;
+    std::string last;
+
+    std::vector<record_t> history;
+  };
+}
+
+#endif
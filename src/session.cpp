@@ -0,0 +1,45 @@
+#include "session.hpp"
+
+
+namespace akbit::system
+{
+  void *Session::allocate(std::size_t size, std::size_t alignment)
+  {
+    if (!blocks.empty())
+    {
+      auto &block = blocks.back();
+      std::size_t offset = (used + alignment - 1) & ~(alignment - 1);
+      if (offset + size <= block.size)
+      {
+        used = offset + size;
+        allocated_bytes += size;
+        return block.data.get() + offset;
+      }
+    }
+
+    // Oversized objects get a block of their own
+    std::size_t capacity = (size > block_size ? size : block_size);
+    blocks.push_back({ std::unique_ptr<std::byte[]>(new std::byte[capacity]), capacity });
+
+    used = size;
+    allocated_bytes += size;
+    return blocks.back().data.get();
+  }
+
+  void Session::reset() noexcept
+  {
+    // Objects may refer to the ones created before them
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+      it->destroy(it->object);
+    destructors.clear();
+
+    if (blocks.size() > 1)
+      blocks.erase(blocks.begin() + 1, blocks.end());
+    if (!blocks.empty() && blocks.front().size != block_size)
+      blocks.clear();
+
+    used = 0;
+    allocated_bytes = 0;
+    context_id = 0;
+  }
+}
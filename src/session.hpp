@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__SESSION_HPP
+#define AKBIT__SYSTEM__SESSION_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace akbit::system
+{
+  /// Owns everything that lives as long as one compilation.
+  /// Nodes, contexts and declaration records are bump-allocated from its
+  /// blocks and referred to by plain pointers; they are all destroyed at once
+  /// when the session is reset or destroyed
+  class Session
+  {
+  public:
+    Session() = default;
+    Session(Session const &) = delete;
+    Session &operator =(Session const &) = delete;
+
+    ~Session() { reset(); }
+
+  public:
+    /// Constructs an object that lives until the session is reset
+    template <class T, class... Args>
+    T *make(Args&&... args)
+    {
+      void *memory = allocate(sizeof(T), alignof(T));
+      T *object = new (memory) T(std::forward<Args>(args)...);
+
+      if constexpr (!std::is_trivially_destructible_v<T>)
+        destructors.push_back({ [](void *o) { static_cast<T *>(o)->~T(); }, object });
+
+      return object;
+    }
+
+    /// Destroys every object of the session.
+    /// The first block is kept, so that the next compilation reuses its memory
+    void reset() noexcept;
+
+    /// Bytes handed out since the last reset
+    inline std::size_t allocated() const noexcept { return allocated_bytes; }
+
+    /// \return id for the next context, they start from 1 after every reset
+    inline std::uint64_t next_context_id() noexcept { return ++context_id; }
+    /// \return id of the last context that was numbered, 0 if none
+    inline std::uint64_t last_context_id() const noexcept { return context_id; }
+
+    /// Makes `last + 1` the id of the next context, so that contexts made
+    /// from several sessions can be numbered as if they came from one
+    inline void restart_context_ids(std::uint64_t last) noexcept { context_id = last; }
+
+  private:
+    void *allocate(std::size_t size, std::size_t alignment);
+
+  private:
+    static constexpr std::size_t block_size = 64 * 1024;
+
+    struct Block
+    {
+      std::unique_ptr<std::byte[]> data;
+      std::size_t size;
+    };
+
+    struct Destructor
+    {
+      void (*destroy)(void *object);
+      void *object;
+    };
+
+    std::vector<Block> blocks;
+    std::size_t used = 0;
+    std::size_t allocated_bytes = 0;
+    std::vector<Destructor> destructors;
+
+    std::uint64_t context_id = 0;
+  };
+}
+
+#endif
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "source.hpp"
+
+
+namespace akbit::system
+{
+  SourceBuffer::~SourceBuffer()
+  {
+    release();
+  }
+
+  void SourceBuffer::release() noexcept
+  {
+    if (nullptr != mapping)
+      munmap(mapping, mapping_size);
+
+    mapping = nullptr;
+    mapping_size = 0;
+    buffer.clear();
+    data = nullptr;
+    length = 0;
+  }
+
+  bool SourceBuffer::open(char const *path)
+  {
+    release();
+
+    if (std::string_view(path) == "-")
+      return read_stream(STDIN_FILENO);
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+      return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+      int reason = errno;
+      close(fd);
+      errno = reason;
+      return false;
+    }
+
+    // Pipes, character devices and alike can not be mapped
+    if (!S_ISREG(info.st_mode))
+    {
+      bool result = read_stream(fd);
+      int reason = errno;
+      close(fd);
+      errno = reason;
+      return result;
+    }
+
+    length = static_cast<std::uint64_t>(info.st_size);
+    if (0 == length)
+    {
+      close(fd);
+      static char const empty[source_padding] = {};
+      data = empty;
+      return true;
+    }
+
+    // The file is mapped over a reservation one page longer than the file.
+    // The tail of its last page and the extra page both read as zeros,
+    // which provides the padding without copying the file.
+    auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    auto file_pages = (static_cast<std::size_t>(length) + page - 1) / page * page;
+
+    mapping_size = file_pages + page;
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED != mapping
+        && MAP_FAILED == mmap(mapping, file_pages, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0))
+    {
+      munmap(mapping, mapping_size);
+      mapping = MAP_FAILED;
+    }
+
+    if (MAP_FAILED == mapping)
+    {
+      // Some file systems do not support mapping, read them as a stream
+      mapping = nullptr;
+      mapping_size = 0;
+      length = 0;
+
+      bool result = read_stream(fd);
+      int reason = errno;
+      close(fd);
+      errno = reason;
+      return result;
+    }
+
+    close(fd);
+    madvise(mapping, file_pages, MADV_SEQUENTIAL);
+    data = static_cast<char const *>(mapping);
+    return true;
+  }
+
+  void SourceBuffer::prefetch() const noexcept
+  {
+    if (nullptr != mapping)
+      madvise(mapping, mapping_size, MADV_WILLNEED);
+  }
+
+  void SourceBuffer::discard_before(std::uint64_t offset) const noexcept
+  {
+    if (nullptr == mapping) return;
+
+    auto page = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+    auto size = std::min(offset, length) / page * page;
+    if (size > 0)
+      madvise(mapping, static_cast<std::size_t>(size), MADV_DONTNEED);
+  }
+
+  void SourceBuffer::assign(std::string_view text_)
+  {
+    std::string copy;
+    copy.reserve(text_.size() + source_padding);
+    copy.append(text_);
+    copy.append(source_padding, '\0');
+
+    release();
+    buffer = std::move(copy);
+    data = buffer.data();
+    length = text_.size();
+  }
+
+  bool SourceBuffer::read_stream(int fd)
+  {
+    constexpr std::size_t chunk_size = 64 * 1024;
+
+    std::size_t used = 0;
+    while (true)
+    {
+      buffer.resize(used + chunk_size);
+      ssize_t count = read(fd, buffer.data() + used, chunk_size);
+      if (count < 0)
+      {
+        if (errno == EINTR) continue;
+        buffer.clear();
+        return false;
+      }
+
+      if (count == 0) break;
+      used += static_cast<std::size_t>(count);
+    }
+
+    buffer.resize(used);
+    buffer.resize(used + source_padding, '\0');
+    data = buffer.data();
+    length = used;
+    return true;
+  }
+
+
+  void LineTable::build()
+  {
+    line_starts.push_back(0);
+
+    char const *begin = text.data();
+    char const *end = begin + text.size();
+    char const *position = begin;
+
+    // memchr is vectorized by the C library, so this scans a block at a time
+    while (position < end)
+    {
+      auto newline = static_cast<char const *>(std::memchr(position, '\n', end - position));
+      if (nullptr == newline)
+        break;
+
+      position = newline + 1;
+      line_starts.push_back(static_cast<std::uint64_t>(position - begin));
+    }
+  }
+
+  SourcePosition LineTable::locate(std::uint64_t offset)
+  {
+    if (line_starts.empty())
+      build();
+
+    offset = std::min<std::uint64_t>(offset, text.size());
+    auto line = std::upper_bound(line_starts.begin(), line_starts.end(), offset) - 1;
+    return {
+      static_cast<std::uint64_t>(line - line_starts.begin()) + 1,
+      offset - *line + 1,
+    };
+  }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__SOURCE_HPP
+#define AKBIT__SYSTEM__SOURCE_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace akbit::system
+{
+  /// Number of zero bytes that follow the text of every SourceBuffer.
+  /// The lexer relies on them as a sentinel and reads whole vectors past the end
+  constexpr std::size_t source_padding = 64;
+
+  /// Read-only storage for the bytes of a single source file.
+  /// Regular files are memory-mapped, anything else (pipes, terminals)
+  /// is read into an owned buffer. Token spellings point into this storage,
+  /// so it has to outlive every token produced from it.
+  /// The text is always followed by `source_padding` zero bytes.
+  class SourceBuffer
+  {
+  public:
+    SourceBuffer() = default;
+    SourceBuffer(SourceBuffer const &) = delete;
+    SourceBuffer &operator =(SourceBuffer const &) = delete;
+    ~SourceBuffer();
+
+  public:
+    /// Loads the file contents
+    /// \param path file to load, "-" stands for the standard input
+    /// \return false if the file could not be read, errno describes the reason
+    bool open(char const *path);
+
+    /// Replaces the contents with a copy of the text
+    void assign(std::string_view text_);
+
+    /// Asks the system to start reading a mapped file in the background,
+    /// so that it is in memory by the time the text is used
+    void prefetch() const noexcept;
+
+    /// Lets the system drop the pages of a mapped file that lie before the offset.
+    /// The text does not change, pages that are read again are loaded again
+    void discard_before(std::uint64_t offset) const noexcept;
+
+    inline std::string_view text() const noexcept { return { data, length }; }
+    inline std::uint64_t size() const noexcept { return length; }
+
+  private:
+    bool read_stream(int fd);
+    void release() noexcept;
+
+  private:
+    char const *data = nullptr;
+    std::uint64_t length = 0;
+
+    void *mapping = nullptr;
+    std::size_t mapping_size = 0;
+
+    std::string buffer;
+  };
+
+
+  struct SourcePosition
+  {
+    std::uint64_t line, column;
+  };
+
+  /// Resolves byte offsets into 1-based line and column numbers.
+  /// Positions are only needed for diagnostics, so the table of line
+  /// starts is built on the first lookup and not while lexing
+  class LineTable
+  {
+  public:
+    LineTable(std::string_view text_)
+      : text(text_)
+      , line_starts{}
+    { }
+
+  public:
+    /// Finds the line containing the offset
+    /// \param offset byte offset into the text, may point one past its end
+    /// \return line and column of the offset
+    SourcePosition locate(std::uint64_t offset);
+
+  private:
+    void build();
+
+  private:
+    std::string_view text;
+    std::vector<std::uint64_t> line_starts;
+  };
+}
+
+#endif
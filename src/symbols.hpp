@@ -0,0 +1,40 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__SYMBOLS_HPP
+#define AKBIT__SYSTEM__SYMBOLS_HPP
+
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+
+namespace akbit::system
+{
+  /// Interned name, equal names have equal symbols.
+  /// Spellings are kept by the LiteralPool that interned them
+  using symbol_t = std::uint32_t;
+
+  /// Symbols every pool starts with, in the order of `builtin_symbols`
+  enum builtin_symbol_t : symbol_t
+  {
+    s_let, s_if, s_then, s_else,
+
+    s_int, s_float, s_string, s_function,
+  };
+
+  inline constexpr std::array<std::string_view, 8> builtin_symbols
+  {
+    "let", "if", "then", "else",
+
+    "int", "float", "string", "function",
+  };
+
+  /// Checks whether the name can not be used for a variable
+  constexpr inline bool is_reserved_symbol(symbol_t symbol) noexcept
+  {
+    return symbol <= s_else;
+  }
+}
+
+#endif
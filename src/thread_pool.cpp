@@ -0,0 +1,65 @@
+#include <utility>
+
+#include "thread_pool.hpp"
+
+
+namespace akbit::system
+{
+  ThreadPool::ThreadPool(std::size_t threads_)
+  {
+    if (0 == threads_) threads_ = 1;
+
+    workers.reserve(threads_);
+    for (std::size_t i = 0; i < threads_; ++i)
+      workers.emplace_back([this, i] { work(i); });
+  }
+
+  ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard lock(guard);
+      stopping = true;
+    }
+    ready.notify_all();
+
+    for (auto &worker : workers)
+      worker.join();
+  }
+
+  void ThreadPool::submit(task_t task)
+  {
+    {
+      std::lock_guard lock(guard);
+      tasks.push_back(std::move(task));
+      ++pending;
+    }
+    ready.notify_one();
+  }
+
+  void ThreadPool::wait()
+  {
+    std::unique_lock lock(guard);
+    idle.wait(lock, [this] { return 0 == pending; });
+  }
+
+  void ThreadPool::work(std::size_t worker)
+  {
+    std::unique_lock lock(guard);
+    while (true)
+    {
+      ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+      if (tasks.empty())
+        return;
+
+      auto task = std::move(tasks.front());
+      tasks.pop_front();
+
+      lock.unlock();
+      task(worker);
+      lock.lock();
+
+      if (0 == --pending)
+        idle.notify_all();
+    }
+  }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__THREAD_POOL_HPP
+#define AKBIT__SYSTEM__THREAD_POOL_HPP
+
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace akbit::system
+{
+  /// Fixed number of threads that run submitted tasks in the order they come.
+  /// Every task gets the index of the thread that runs it, so that the caller
+  /// can keep state per thread and reuse it from task to task
+  class ThreadPool
+  {
+  public:
+    using task_t = std::function<void(std::size_t worker)>;
+
+  public:
+    /// \param threads_ number of threads, at least one is started
+    explicit ThreadPool(std::size_t threads_);
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator =(ThreadPool const &) = delete;
+
+    /// Runs the tasks that are still queued and stops the threads
+    ~ThreadPool();
+
+  public:
+    void submit(task_t task);
+
+    /// Blocks until every task submitted so far has finished
+    void wait();
+
+    inline std::size_t size() const noexcept { return workers.size(); }
+
+  private:
+    void work(std::size_t worker);
+
+  private:
+    std::vector<std::thread> workers;
+
+    std::mutex guard;
+    std::condition_variable ready;
+    std::condition_variable idle;
+    std::deque<task_t> tasks;
+    /// Tasks that are queued or running
+    std::size_t pending = 0;
+    bool stopping = false;
+  };
+}
+
+#endif
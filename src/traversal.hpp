@@ -0,0 +1,156 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__TRAVERSAL_HPP
+#define AKBIT__SYSTEM__TRAVERSAL_HPP
+
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "node.hpp"
+
+
+namespace akbit::system
+{
+  template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
+  template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
+
+  /// Names the payload type `T` where there is no payload to pass
+  template <class T>
+  struct node_tag { using type = T; };
+
+
+  /// Calls `visitor(node, payload)` with the payload of the node.
+  /// The overload is chosen for the exact payload type at compile time,
+  /// a generic overload catches the kinds the visitor does not care about
+  template <class N, class Visitor>
+    requires std::is_same_v<std::remove_const_t<N>, Node>
+  decltype(auto) dispatch(N &node, Visitor &&visitor)
+  {
+    return std::visit([&](auto &value) -> decltype(auto) { return visitor(node, value); }, node.value);
+  }
+
+  /// Calls `visitor(node_tag<T>{})` with the payload type of the kind,
+  /// for node kinds that are stored without their payload (see FlatTree)
+  template <class Visitor>
+  decltype(auto) dispatch(Node::kind_t kind, Visitor &&visitor)
+  {
+    using visitor_t = std::remove_reference_t<Visitor>;
+    using result_t = decltype(visitor(node_tag<Node::unknown_t>{}));
+
+    return [&]<std::size_t... K>(std::index_sequence<K...>) -> result_t {
+      static constexpr result_t (*table[])(visitor_t &) = {
+        [](visitor_t &v) -> result_t { return v(node_tag<std::variant_alternative_t<K, Node::node_variant_t>>{}); }...
+      };
+      return table[kind](visitor);
+    }(std::make_index_sequence<std::variant_size_v<Node::node_variant_t>>{});
+  }
+
+
+  /// Calls `f` with the slot of every child of the node in their order.
+  /// Slots of optional children that are absent hold nullptr;
+  /// assigning a slot of a mutable node replaces the child
+  template <class N, class F>
+    requires std::is_same_v<std::remove_const_t<N>, Node>
+  void for_each_child(N &node, F &&f)
+  {
+    dispatch(node, [&](N &, auto &value) {
+      using T = std::remove_cvref_t<decltype(value)>;
+
+      if constexpr (std::is_same_v<T, Node::module_t>)
+        for (auto &d : value.data) f(d);
+      else if constexpr (std::is_same_v<T, Node::declaration_t>)
+        f(value.variable), f(value.type), f(value.value);
+      else if constexpr (std::is_same_v<T, Node::condition_t>)
+        f(value.expression), f(value.clause_true), f(value.clause_false);
+      else if constexpr (std::is_same_v<T, Node::block_t>)
+        for (auto &stmt : value.code) f(stmt);
+      else if constexpr (std::is_same_v<T, Node::binary_operation_t>)
+        for (auto &operand : value.operands) f(operand);
+      else if constexpr (std::is_same_v<T, Node::unary_operation_t>)
+        f(value.expression);
+      else if constexpr (std::is_same_v<T, Node::function_call_t>)
+        f(value.expression), f(value.arguments);
+      else if constexpr (std::is_same_v<T, Node::value_function_t>)
+      {
+        for (auto &param : value.parameters) f(param);
+        f(value.body);
+      }
+      else if constexpr (std::is_same_v<T, Node::value_tuple_t>)
+        for (auto &entry : value.entries) f(entry);
+    });
+  }
+
+
+  namespace traversal_detail
+  {
+    /// Pointer a parent keeps to a child, it cannot be assigned in a const tree
+    template <class N>
+    using slot_t = std::conditional_t<std::is_const_v<N>, N * const, N *>;
+
+    template <class N, class Enter, class Leave>
+    void walk(slot_t<N> &root, Enter &enter, Leave &leave)
+    {
+      struct task_t
+      {
+        slot_t<N> * slot;
+        std::size_t index;
+        bool entered;
+      };
+
+      std::vector<task_t> tasks{ { &root, 0, false } };
+      std::vector<slot_t<N> *> children;
+
+      while (!tasks.empty())
+      {
+        auto task = tasks.back();
+        tasks.pop_back();
+
+        if (task.entered)
+        {
+          leave(*task.slot);
+          continue;
+        }
+
+        enter(*task.slot, task.index);
+        tasks.push_back({ task.slot, task.index, true });
+
+        // Children are read after the hook, a replaced node has its own
+        if (nullptr == *task.slot)
+          continue;
+
+        children.clear();
+        for_each_child(**task.slot, [&](auto &child) { children.push_back(&child); });
+        for (auto index = children.size(); index --> 0;)
+          tasks.push_back({ children[index], index, false });
+      }
+    }
+  }
+
+  /// Calls `enter(slot, index)` for every node in pre-order and `leave(slot)`
+  /// after its children. `slot` is the `Node *&` the parent keeps the node in:
+  /// assigning it in `enter` walks the new node instead, assigning it in
+  /// `leave` replaces the walked node. Hooks may replace nodes but must not
+  /// add or remove children of the nodes above them.
+  /// Absent optional children are passed as nullptr, `index` is the position
+  /// of the node among the children of its parent.
+  /// Pending nodes are kept on the heap, so any depth of the tree is fine
+  /// \param root slot of the root, replacing the root assigns it
+  template <class Enter, class Leave>
+  void walk(Node *&root, Enter &&enter, Leave &&leave)
+  {
+    traversal_detail::walk<Node>(root, enter, leave);
+  }
+
+  /// Walks a tree that is only read, hooks get `Node const * const &` slots
+  template <class Enter, class Leave>
+  void walk(Node const * root, Enter &&enter, Leave &&leave)
+  {
+    traversal_detail::walk<Node const>(root, enter, leave);
+  }
+}
+
+#endif
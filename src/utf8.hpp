@@ -0,0 +1,96 @@
+#pragma once
+
+#ifndef AKBIT__SYSTEM__UTF8_HPP
+#define AKBIT__SYSTEM__UTF8_HPP
+
+
+#include <cstdint>
+#include <string>
+
+
+namespace akbit::system
+{
+  /// Decodes a single UTF-8 sequence.
+  /// Overlong forms, surrogates and code points past U+10FFFF are rejected
+  /// \param text first byte of the sequence
+  /// \param remaining number of readable bytes starting from `text`
+  /// \param code_point receives the decoded code point
+  /// \return length of the sequence in bytes or 0 if it is not valid
+  inline std::uint32_t decode_utf8(char const *text, std::uint64_t remaining, std::uint32_t &code_point) noexcept
+  {
+    auto const *bytes = reinterpret_cast<unsigned char const *>(text);
+    auto is_continuation = [&](std::uint32_t at) { return (bytes[at] & 0xC0u) == 0x80u; };
+
+    if (remaining == 0)
+      return 0;
+
+    if (bytes[0] < 0x80u)
+    {
+      code_point = bytes[0];
+      return 1;
+    }
+
+    if (bytes[0] < 0xC2u)
+      return 0;
+
+    if (bytes[0] < 0xE0u)
+    {
+      if (remaining < 2 || !is_continuation(1))
+        return 0;
+      code_point = ((bytes[0] & 0x1Fu) << 6) | (bytes[1] & 0x3Fu);
+      return 2;
+    }
+
+    if (bytes[0] < 0xF0u)
+    {
+      if (remaining < 3 || !is_continuation(1) || !is_continuation(2))
+        return 0;
+      code_point = ((bytes[0] & 0x0Fu) << 12) | ((bytes[1] & 0x3Fu) << 6) | (bytes[2] & 0x3Fu);
+      if (code_point < 0x800u || (code_point >= 0xD800u && code_point <= 0xDFFFu))
+        return 0;
+      return 3;
+    }
+
+    if (bytes[0] < 0xF5u)
+    {
+      if (remaining < 4 || !is_continuation(1) || !is_continuation(2) || !is_continuation(3))
+        return 0;
+      code_point = ((bytes[0] & 0x07u) << 18) | ((bytes[1] & 0x3Fu) << 12)
+        | ((bytes[2] & 0x3Fu) << 6) | (bytes[3] & 0x3Fu);
+      if (code_point < 0x10000u || code_point > 0x10FFFFu)
+        return 0;
+      return 4;
+    }
+
+    return 0;
+  }
+
+  /// Appends the UTF-8 form of a code point
+  inline void encode_utf8(std::uint32_t code_point, std::string &output)
+  {
+    if (code_point < 0x80u)
+    {
+      output += static_cast<char>(code_point);
+    }
+    else if (code_point < 0x800u)
+    {
+      output += static_cast<char>(0xC0u | (code_point >> 6));
+      output += static_cast<char>(0x80u | (code_point & 0x3Fu));
+    }
+    else if (code_point < 0x10000u)
+    {
+      output += static_cast<char>(0xE0u | (code_point >> 12));
+      output += static_cast<char>(0x80u | ((code_point >> 6) & 0x3Fu));
+      output += static_cast<char>(0x80u | (code_point & 0x3Fu));
+    }
+    else
+    {
+      output += static_cast<char>(0xF0u | (code_point >> 18));
+      output += static_cast<char>(0x80u | ((code_point >> 12) & 0x3Fu));
+      output += static_cast<char>(0x80u | ((code_point >> 6) & 0x3Fu));
+      output += static_cast<char>(0x80u | (code_point & 0x3Fu));
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#ifndef AKBIT__TESTS__CHECK_HPP
+#define AKBIT__TESTS__CHECK_HPP
+
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace akbit::tests
+{
+  inline int failures = 0;
+
+  /// \return contents of every script of the corpus, in the order of their names
+  inline std::vector<std::string> read_corpus(char const *directory = "wit_test_scripts")
+  {
+    std::vector<std::filesystem::path> paths;
+    for (auto &entry : std::filesystem::directory_iterator(directory))
+      if (entry.path().extension() == ".ws")
+        paths.push_back(entry.path());
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<std::string> scripts;
+    for (auto &path : paths)
+    {
+      std::ifstream file(path, std::ios::binary);
+      std::ostringstream text;
+      text << file.rdbuf();
+      scripts.push_back(text.str());
+    }
+    return scripts;
+  }
+
+  /// \return exit code of the test
+  inline int finish(char const *name)
+  {
+    if (failures > 0)
+      std::printf("%s: %d checks failed\n", name, failures);
+    else
+      std::printf("%s: passed\n", name);
+    return (failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+  }
+}
+
+/// Reports a failed condition and goes on with the test
+#define CHECK(condition) \
+  ((condition) ? true : (std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition), ++::akbit::tests::failures, false))
+
+#endif
@@ -0,0 +1,82 @@
+// Parsing of a single expression has to take time linear in its operands,
+// from 10^5 to 10^6 of them
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "session.hpp"
+#include "source.hpp"
+#include "parsing/lexing.hpp"
+#include "parsing/literals.hpp"
+#include "parsing/parsing.hpp"
+
+
+namespace
+{
+  using namespace akbit::system;
+
+  constexpr int rounds = 3;
+
+  /// `let x = a0 + a1 * a2 >= ...` with operators of every precedence mixed
+  std::string make_expression(std::size_t operands)
+  {
+    static char const *const operators[] = { " + ", " - ", " * ", " / ", " % ", " ^ ", " >= ", " < ", " == ", " && ", " || ", " & " };
+
+    std::mt19937 random(10);
+    std::string text = "let x = a0";
+    for (std::size_t i = 1; i < operands; ++i)
+    {
+      text += operators[random() % std::size(operators)];
+      text += "a" + std::to_string(i % 100);
+    }
+    return text + "\n";
+  }
+
+  /// \return seconds parsing the text takes, lexing is not counted
+  double parse_seconds(std::string const &text)
+  {
+    SourceBuffer source;
+    source.assign(text);
+
+    double best = 1e9;
+    for (int i = 0; i < rounds; ++i)
+    {
+      parsing::LiteralPool literals;
+      auto tokens = parsing::tokenize(source.text(), literals);
+
+      Session session;
+      auto start = std::chrono::steady_clock::now();
+      auto module = parsing::parse(tokens, literals, source.text(), session);
+      best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+      CHECK(!std::get<Node::module_t>(module->value).has_errors);
+    }
+    return best;
+  }
+}
+
+int main()
+{
+  std::vector<std::size_t> sizes{ 100000, 200000, 500000, 1000000 };
+
+  std::vector<double> per_operand;
+  for (auto operands : sizes)
+  {
+    auto seconds = parse_seconds(make_expression(operands));
+    per_operand.push_back(seconds / operands);
+    std::printf("  %8zu operands: %8.1f ms, %6.3f us per operand\n", operands, seconds * 1e3, seconds / operands * 1e6);
+  }
+
+  // Linear growth keeps the time per operand flat, a quadratic parser would
+  // take ten times as long per operand at 10^6 as at 10^5. The margin is
+  // for caches and the allocator
+  auto fastest = *std::min_element(per_operand.begin(), per_operand.end());
+  if (!CHECK(per_operand.back() <= 3 * fastest))
+    std::printf("  time per operand grows from %.3f us to %.3f us\n", fastest * 1e6, per_operand.back() * 1e6);
+
+  return akbit::tests::finish("expression_scaling");
+}
@@ -0,0 +1,206 @@
+// IncrementalCompiler has to write the file a fresh compilation writes after
+// every edit of the statements, annotating again only the changed statements
+// and the ones whose global names resolve differently. An edit with an error
+// fails and leaves the file and the kept statements as they were
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "incremental.hpp"
+#include "source.hpp"
+
+
+namespace
+{
+  using namespace akbit::system;
+
+  /// Top-level statement with what it declares and uses, types are tagged
+  /// by a character: 'i', 'd', 's' for literals and 'f' for functions
+  struct statement_t
+  {
+    std::string text;
+    std::string declares;
+    char type = 0;
+    std::vector<std::string> uses;
+  };
+
+  using module_t = std::vector<statement_t>;
+
+  /// Declarations of a few names that get redeclared with other types,
+  /// functions that use them and calls of both
+  statement_t random_statement(std::mt19937 &random)
+  {
+    auto pick = [&](int count) { return std::to_string(random() % count); };
+    auto value = pick(100);
+    switch (random() % 3)
+    {
+    case 0:
+      switch (random() % 3)
+      {
+      case 0: return { "let v" + pick(6) + " = " + value, {}, 'i', {} };
+      case 1: return { "let v" + pick(6) + " = " + value + ".5", {}, 'd', {} };
+      default: return { "let v" + pick(6) + " = \"s" + value + "\"", {}, 's', {} };
+      }
+    case 1:
+    {
+      auto used = "v" + pick(6);
+      return { "let f" + pick(3) + " = x -> x + " + used, {}, 'f', { used } };
+    }
+    default:
+    {
+      auto value_used = "v" + pick(6), function_used = "f" + pick(3);
+      return { "print(" + value_used + ", " + function_used + "(" + value + "))", {}, 0, { value_used, function_used } };
+    }
+    }
+  }
+
+  /// Fills in the declared name from the text
+  statement_t declaration(statement_t statement)
+  {
+    if (0 != statement.type)
+      statement.declares = statement.text.substr(4, statement.text.find(' ', 4) - 4);
+    return statement;
+  }
+
+  std::string text_of(module_t const &module)
+  {
+    std::string text;
+    for (auto &statement : module)
+      text += statement.text + "\n";
+    return text;
+  }
+
+  /// \return type of the first declaration of the name before the statement, 0 if there is none
+  char resolve(module_t const &module, std::size_t statement, std::string const &name)
+  {
+    for (std::size_t i = 0; i < statement; ++i)
+      if (module[i].declares == name)
+        return module[i].type;
+    return 0;
+  }
+
+  /// \return report that compiling the module after the previous one has to give
+  IncrementalCompiler::report_t expected_report(module_t const &previous, module_t const &module)
+  {
+    std::vector<bool> taken(previous.size(), false);
+    IncrementalCompiler::report_t report;
+    for (std::size_t i = 0; i < module.size(); ++i)
+    {
+      ++report.statements;
+      std::size_t j = 0;
+      while (j < previous.size() && (taken[j] || previous[j].text != module[i].text))
+        ++j;
+      if (j == previous.size())
+      {
+        ++report.changed;
+        continue;
+      }
+      taken[j] = true;
+
+      bool same = true;
+      for (auto &name : module[i].uses)
+        same = same && resolve(previous, j, name) == resolve(module, i, name);
+      ++(same ? report.reused : report.dependents);
+    }
+    return report;
+  }
+
+  bool operator ==(IncrementalCompiler::report_t const &a, IncrementalCompiler::report_t const &b)
+  {
+    return a.statements == b.statements && a.changed == b.changed && a.dependents == b.dependents && a.reused == b.reused;
+  }
+
+  std::string read_file(std::filesystem::path const &path)
+  {
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream text;
+    text << file.rdbuf();
+    return text.str();
+  }
+}
+
+int main()
+{
+  namespace fs = std::filesystem;
+
+  auto directory = fs::temp_directory_path() / "witcc_incremental";
+  fs::create_directories(directory);
+  auto output = (directory / "program.out.js").string();
+  auto fresh_output = (directory / "fresh.out.js").string();
+
+  // Type mismatches and syntax errors are reported on the way
+  std::cout.setstate(std::ios::badbit);
+  std::cerr.setstate(std::ios::badbit);
+
+  std::mt19937 random(25);
+  module_t module;
+  for (int i = 0; i < 40; ++i)
+    module.push_back(declaration(random_statement(random)));
+
+  IncrementalCompiler compiler;
+  module_t previous;
+  int failed_edits = 0;
+  for (int round = 0; round < 300; ++round)
+  {
+    if (round > 0)
+    {
+      for (auto edits = 1 + random() % 3; edits > 0; --edits)
+      {
+        auto at = random() % module.size();
+        switch (random() % 4)
+        {
+        case 0: module[at] = declaration(random_statement(random)); break;
+        case 1: module.insert(module.begin() + at, declaration(random_statement(random))); break;
+        case 2: if (module.size() > 1) module.erase(module.begin() + at); break;
+        default: if (at + 1 < module.size()) std::swap(module[at], module[at + 1]); break;
+        }
+      }
+    }
+
+    // A syntax error or a lexical one in the middle of the module
+    if (round % 8 == 7)
+    {
+      auto broken = module;
+      auto error = (random() % 2 ? "let e = (1 +" : "let e = \"not closed");
+      broken.insert(broken.begin() + random() % broken.size(), { error, {}, 0, {} });
+
+      auto before = read_file(output);
+      auto report = compiler.report();
+      SourceBuffer source;
+      source.assign(text_of(broken));
+      CHECK(!compiler.compile(source, output.c_str()));
+      CHECK(read_file(output) == before);
+      CHECK(compiler.report() == report);
+      ++failed_edits;
+      continue;
+    }
+
+    SourceBuffer source;
+    source.assign(text_of(module));
+    if (!CHECK(compiler.compile(source, output.c_str())))
+      break;
+    CHECK(compiler.report() == expected_report(previous, module));
+
+    IncrementalCompiler fresh;
+    CHECK(fresh.compile(source, fresh_output.c_str()));
+    CHECK(fresh.report() == expected_report({}, module));
+    CHECK(read_file(output) == read_file(fresh_output));
+    previous = module;
+  }
+
+  // The kept statements are the ones of the last compilation that succeeded
+  SourceBuffer source;
+  source.assign(text_of(previous));
+  CHECK(compiler.compile(source, output.c_str()));
+  CHECK(compiler.report().reused == previous.size());
+  CHECK(failed_edits > 0);
+
+  fs::remove_all(directory);
+  return akbit::tests::finish("incremental");
+}
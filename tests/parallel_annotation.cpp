@@ -0,0 +1,152 @@
+// Annotation of the global functions on a thread pool has to give the
+// result types, the record bindings, the context ids and the messages
+// of the serial pass, the messages in the same order
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "annotation.hpp"
+#include "context.hpp"
+#include "session.hpp"
+#include "source.hpp"
+#include "thread_pool.hpp"
+#include "traversal.hpp"
+#include "parsing/lexing.hpp"
+#include "parsing/literals.hpp"
+#include "parsing/parsing.hpp"
+
+
+namespace
+{
+  using namespace akbit::system;
+
+  /// Module of 10^4 top-level functions that call each other before and
+  /// after their declaration, with redeclarations, shadowing, nested
+  /// scopes and statements that are not functions in between
+  std::string make_module(std::size_t functions)
+  {
+    std::mt19937 random(22);
+    auto other = [&] { return "f" + std::to_string(random() % functions); };
+
+    std::string text;
+    for (std::size_t i = 0; i < functions; ++i)
+    {
+      auto f = "f" + std::to_string(i);
+      switch (i % 8)
+      {
+        case 0: text += "let " + f + " = (a, b) -> if a > 0 then " + f + "(a - 1, b) + " + other() + "(b, a) else " + other() + "(a, b) * 2\n"; break;
+        case 1: text += "let " + f + ": function = n: int -> { let x = n * 3 + " + other() + "(n)\n let g = m -> x + m + " + f + "\n g(" + other() + ") }\n"; break;
+        case 2: text += "let v" + std::to_string(i) + " = " + other() + "(3) + " + other() + "\nlet " + f + " = n -> n + v" + std::to_string(i) + " + \"s\"\n"; break;
+        case 3: text += "let " + f + ": int = () -> " + f + "\nlet " + f + " = x -> y -> (x, y, " + f + ", " + other() + ")\n"; break;
+        case 4: text += "let " + f + " = x -> " + other() + "(x)(x)\nprint(" + f + "(1), (q -> q + 1)(2))\n"; break;
+        case 5: text += "let " + f + " = (a, b, c) -> { let z = a + b\n let w = (t -> t + z + c)\n w(z) }\n"; break;
+        case 6: text += "let " + f + " = x -> 1.5 + x + " + f + "\n"; break;
+        default: text += "let " + f + " = s -> if s == 'c then \"" + f + "\" else " + other() + "(s, 'd)\n"; break;
+      }
+    }
+    return text;
+  }
+
+  struct annotated_t
+  {
+    Session session;
+    Node * module;
+    std::string messages;
+  };
+
+  void annotate(std::string_view source, parsing::LiteralPool &literals, std::vector<parsing::Token> &tokens, annotated_t &result, ThreadPool * pool)
+  {
+    result.module = parsing::parse(tokens, literals, source, result.session);
+
+    std::ostringstream messages;
+    auto previous = capture_diagnostics(&messages);
+    annotation::generate_context(result.module, result.session, pool);
+    capture_diagnostics(previous);
+    result.messages = messages.str();
+  }
+
+  std::vector<Node const *> nodes_of(Node const * root)
+  {
+    std::vector<Node const *> nodes;
+    walk(root, [&](Node const * node, std::size_t) { nodes.push_back(node); }, [](Node const *) { });
+    return nodes;
+  }
+
+  /// \return position of the record among the declarations of its context
+  std::size_t slot_of(DeclarationRecord const * record)
+  {
+    auto &declarations = record->context->declarations;
+    for (std::size_t i = 0; i < declarations.size(); ++i)
+      if (declarations[i] == record) return i;
+    return declarations.size();
+  }
+
+  bool same_record(DeclarationRecord const * a, DeclarationRecord const * b)
+  {
+    if (nullptr == a || nullptr == b)
+      return a == b;
+    return a->name == b->name && a->type == b->type
+        && a->context->id == b->context->id && slot_of(a) == slot_of(b);
+  }
+
+  bool same_annotation(Node const * a, Node const * b)
+  {
+    if (nullptr == a || nullptr == b)
+      return a == b;
+    if (a->kind() != b->kind() || a->result_type != b->result_type)
+      return false;
+    if ((nullptr == a->context) != (nullptr == b->context) || (a->context && a->context->id != b->context->id))
+      return false;
+
+    if (auto variable = a->as<Node::value_variable_t>())
+      return same_record(variable->record, b->as<Node::value_variable_t>()->record);
+    if (auto function = a->as<Node::value_function_t>())
+    {
+      auto other = b->as<Node::value_function_t>();
+      return (nullptr == function->owned_context) == (nullptr == other->owned_context)
+          && (nullptr == function->owned_context || function->owned_context->id == other->owned_context->id);
+    }
+    return true;
+  }
+}
+
+int main()
+{
+  SourceBuffer source;
+  source.assign(make_module(10000));
+
+  parsing::LiteralPool literals;
+  auto tokens = parsing::tokenize(source.text(), literals);
+
+  annotated_t serial;
+  annotate(source.text(), literals, tokens, serial, nullptr);
+  CHECK(!std::get<Node::module_t>(serial.module->value).has_errors);
+  // Type mismatches both in the values of functions and in other statements
+  CHECK(serial.messages.find("Binary operation type mismatch") != std::string::npos);
+  auto expected = nodes_of(serial.module);
+  auto &expected_messages = serial.messages;
+
+  for (std::size_t threads : { 1, 2, 4, 8 })
+  {
+    ThreadPool pool(threads);
+    annotated_t parallel;
+    annotate(source.text(), literals, tokens, parallel, &pool);
+    auto actual = nodes_of(parallel.module);
+
+    if (!CHECK(expected.size() == actual.size()))
+      continue;
+
+    std::size_t differences = 0;
+    for (std::size_t i = 0; i < expected.size(); ++i)
+      if (!same_annotation(expected[i], actual[i]) && differences++ == 0)
+        std::printf("  %zu threads: node %zu differs\n", threads, i);
+    CHECK(0 == differences);
+    CHECK(expected_messages == parallel.messages);
+  }
+
+  return akbit::tests::finish("parallel_annotation");
+}
@@ -0,0 +1,132 @@
+// tokenize_parallel() has to give the tokens tokenize() gives, field by field,
+// literal ids included, whatever the number of threads. A lexical error is
+// reported by both of them and by a stream that lexes on demand
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "source.hpp"
+#include "parsing/lexing.hpp"
+#include "parsing/literals.hpp"
+#include "parsing/token_stream.hpp"
+
+
+namespace
+{
+  using namespace akbit::system;
+  using parsing::Token;
+  using parsing::TokenType;
+
+  /// Text whose chunks start inside of strings, comments and character
+  /// literals, with names met for the first time in every part of it
+  std::string make_tricky_text(std::size_t size)
+  {
+    std::mt19937 random(5);
+    auto pick = [&](std::uint32_t count) { return std::uniform_int_distribution<std::uint32_t>(0, count - 1)(random); };
+
+    std::string text;
+    while (text.size() < size)
+    {
+      switch (pick(8))
+      {
+        case 0: text += "let n" + std::to_string(pick(20000)) + " = " + std::to_string(pick(1000)) + "\n"; break;
+        case 1: text += "print(\"plain text\", \"escaped\\t\\\"text\\\"\")\n"; break;
+        case 2: text += "let s = \"a string\nover\nseveral lines " + std::to_string(pick(100)) + "\"\n"; break;
+        case 3: text += "// a commentary with a \" quote and a 'c\n"; break;
+        case 4: text += "let c = ('\" , '\\n, 'x)\n"; break;
+        case 5: text += "f(a, b) -> a * 1.5 + b >= 2 && a != b || n" + std::to_string(pick(20000)) + "\n"; break;
+        case 6: text += "\"\n\n\n\"\n"; break;
+        default: text += "\n   \t\n"; break;
+      }
+    }
+    return text;
+  }
+
+  void check_same(std::string_view name, std::size_t threads,
+                  std::vector<Token> const &expected, parsing::LiteralPool const &expected_literals,
+                  std::vector<Token> const &actual, parsing::LiteralPool const &actual_literals)
+  {
+    if (!CHECK(expected.size() == actual.size()))
+    {
+      std::printf("  %.*s on %zu threads: %zu tokens instead of %zu\n", int(name.size()), name.data(), threads, actual.size(), expected.size());
+      return;
+    }
+
+    std::size_t differences = 0;
+    for (std::size_t i = 0; i < expected.size(); ++i)
+    {
+      auto &a = expected[i];
+      auto &b = actual[i];
+      bool same = a.index == b.index
+               && a.value.data() == b.value.data() && a.value.size() == b.value.size()
+               && a.type == b.type && a.sub_type == b.sub_type
+               && a.literal == b.literal;
+
+      if (same && a.type == TokenType::t_identifier)
+        same = expected_literals.spelling(a.literal) == actual_literals.spelling(b.literal);
+      if (same && a.type == TokenType::t_string)
+        same = expected_literals.text(a) == actual_literals.text(b);
+
+      if (!same && differences++ == 0)
+        std::printf("  %.*s on %zu threads: token %zu differs\n", int(name.size()), name.data(), threads, i);
+    }
+    CHECK(0 == differences);
+  }
+
+  /// \return whether tokenize() has failed on the text
+  bool check_text(std::string_view name, std::string const &text)
+  {
+    SourceBuffer source;
+    source.assign(text);
+
+    bool expected_failed = false;
+    parsing::LiteralPool expected_literals;
+    auto expected = parsing::tokenize(source.text(), expected_literals, &expected_failed);
+
+    for (std::size_t threads : { 2, 3, 4, 7, 8, 16 })
+    {
+      bool failed = !expected_failed;
+      parsing::LiteralPool literals;
+      auto tokens = parsing::tokenize_parallel(source.text(), literals, threads, &failed);
+      check_same(name, threads, expected, expected_literals, tokens, literals);
+      CHECK(failed == expected_failed);
+    }
+
+    // A stream that lexes on demand ends at the same token
+    parsing::LiteralPool literals;
+    parsing::LexerState lexer(source.text(), literals);
+    parsing::TokenStream stream(lexer);
+    std::size_t count = 0;
+    while (stream.at(count).type != TokenType::t_eof)
+      stream.release(++count);
+    CHECK(count + 1 == expected.size());
+    CHECK(stream.is_failed() == expected_failed);
+
+    return expected_failed;
+  }
+}
+
+int main()
+{
+  // Lexical errors are logged to the standard output
+  std::cout.setstate(std::ios::badbit);
+
+  auto tricky = make_tricky_text(4 * 1024 * 1024);
+  CHECK(!check_text("tricky text", tricky));
+  // The error is in the last chunk, after a string that is not closed
+  CHECK(check_text("unclosed string", tricky + "let s = \"abc\n"));
+
+  std::string corpus;
+  for (auto &script : akbit::tests::read_corpus())
+    corpus += script + "\n";
+  std::string repeated;
+  while (repeated.size() < 4 * 1024 * 1024)
+    repeated += corpus;
+  CHECK(!check_text("corpus", repeated));
+
+  return akbit::tests::finish("parallel_lexing");
+}
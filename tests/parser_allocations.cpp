@@ -0,0 +1,75 @@
+// The parser views tokens instead of copying them and moves node payloads
+// into place, its allocations per token over the corpus are bounded
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "check.hpp"
+#include "session.hpp"
+#include "source.hpp"
+#include "parsing/lexing.hpp"
+#include "parsing/literals.hpp"
+#include "parsing/parsing.hpp"
+
+
+namespace
+{
+  std::atomic<std::size_t> allocations = 0;
+
+  /// Allocations per token the parser may make, the nodes, their payloads
+  /// and the growth of the session's blocks and of the parser's stack
+  constexpr double max_allocations_per_token = 0.6;
+}
+
+void * operator new(std::size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto pointer = std::malloc(size == 0 ? 1 : size))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void * operator new[](std::size_t size)
+{
+  return ::operator new(size);
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept { std::free(pointer); }
+
+
+int main()
+{
+  using namespace akbit::system;
+
+  std::size_t tokens_parsed = 0;
+  std::size_t parser_allocations = 0;
+
+  for (auto &script : akbit::tests::read_corpus())
+  {
+    SourceBuffer source;
+    source.assign(script);
+
+    parsing::LiteralPool literals;
+    auto tokens = parsing::tokenize(source.text(), literals);
+
+    Session session;
+    auto before = allocations.load();
+    auto module = parsing::parse(tokens, literals, source.text(), session);
+    parser_allocations += allocations.load() - before;
+    tokens_parsed += tokens.size();
+
+    CHECK(!std::get<Node::module_t>(module->value).has_errors);
+  }
+
+  auto per_token = double(parser_allocations) / double(tokens_parsed);
+  std::printf("  %zu allocations for %zu tokens, %.3f per token\n", parser_allocations, tokens_parsed, per_token);
+  CHECK(tokens_parsed > 0);
+  CHECK(per_token <= max_allocations_per_token);
+
+  return akbit::tests::finish("parser_allocations");
+}
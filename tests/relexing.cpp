@@ -0,0 +1,185 @@
+// EditedTokens has to give the tokens a full tokenize() of the edited text
+// gives after every edit, while re-lexing only around the edit
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "source.hpp"
+#include "parsing/lexing.hpp"
+#include "parsing/literals.hpp"
+#include "parsing/relexing.hpp"
+
+
+namespace
+{
+  using namespace akbit::system;
+  using parsing::Token;
+  using parsing::TokenType;
+
+  /// Pieces of text that lex without errors wherever they are put,
+  /// but for a lone quote now and then and for edits that cut an escape
+  std::vector<std::string> const snippets{
+    "a", "b1", "let ", " ", "\n", "\t", "x = 1\n", "12", "3.5", ".", "->", "-", ">", "=", "==",
+    "\"text\"", "\"esc\\t\\\"aped\"", "\"two\nlines\"", "//", "// note\n", "'c", "'\\n", "''",
+    "(", ")", "{", "}", ",", "print(f(1, 2))\n", "if a then b else c\n",
+  };
+
+  /// Text followed by the padding the lexer reads past its end
+  struct padded_text_t
+  {
+    std::string text;
+    std::string storage;
+
+    std::string_view view()
+    {
+      storage = text;
+      storage.append(source_padding, '\0');
+      return { storage.data(), text.size() };
+    }
+  };
+
+  bool same_tokens(std::vector<Token> const &expected, parsing::LiteralPool const &expected_literals,
+                   std::vector<Token> const &actual, parsing::LiteralPool const &actual_literals)
+  {
+    if (expected.size() != actual.size())
+      return false;
+
+    for (std::size_t i = 0; i < expected.size(); ++i)
+    {
+      auto &a = expected[i];
+      auto &b = actual[i];
+      if (a.index != b.index || a.value.data() != b.value.data() || a.value.size() != b.value.size()
+          || a.type != b.type || a.sub_type != b.sub_type)
+        return false;
+
+      // Names and texts are compared, the ids depend on what was lexed before
+      if (a.type == TokenType::t_identifier && expected_literals.spelling(a.literal) != actual_literals.spelling(b.literal))
+        return false;
+      if (a.type == TokenType::t_string && expected_literals.text(a) != actual_literals.text(b))
+        return false;
+      if (a.type != TokenType::t_identifier && a.type != TokenType::t_string && a.literal != b.literal)
+        return false;
+    }
+    return true;
+  }
+
+  void check_random_edits()
+  {
+    std::mt19937 random(11);
+    auto pick = [&](std::size_t count) { return std::uniform_int_distribution<std::size_t>(0, count - 1)(random); };
+
+    padded_text_t text;
+    for (int i = 0; i < 3000; ++i)
+      text.text += snippets[pick(snippets.size())];
+
+    parsing::LiteralPool literals;
+    parsing::EditedTokens tokens(text.view(), literals);
+
+    std::size_t failed_edits = 0;
+    std::size_t incremental = 0;
+
+    // \return whether the edited text lexes without errors
+    auto edit = [&](int step, std::size_t offset, std::size_t removed, std::string const &inserted) {
+      text.text.replace(offset, removed, inserted);
+      auto view = text.view();
+      tokens.apply(view, { offset, removed, inserted });
+
+      parsing::LiteralPool expected_literals;
+      auto expected = parsing::tokenize(view, expected_literals);
+      incremental += (tokens.last_edit().lexed < expected.size());
+      if (!same_tokens(expected, expected_literals, tokens.tokens(), literals) && failed_edits++ == 0)
+        std::printf("  edit %d at %zu (-%zu +%zu) gives other tokens than tokenize()\n", step, offset, removed, inserted.size());
+
+      // Tokens of a range are the ones of the full list that start in it
+      auto begin = pick(text.text.size() + 1);
+      auto end = begin + pick(200);
+      std::vector<Token> slice;
+      for (auto &token : expected)
+      {
+        auto start = (token.type == TokenType::t_character ? token.index - 1 : token.index);
+        if (start >= begin && start < end)
+          slice.push_back(token);
+      }
+      if (!same_tokens(slice, expected_literals, tokens.tokens(begin, end), literals) && failed_edits++ == 0)
+        std::printf("  edit %d: tokens of [%zu, %zu) differ\n", step, begin, end);
+
+      return expected.back().index == text.text.size();
+    };
+
+    // Edits are mostly a few bytes, some remove or paste more than a chunk
+    constexpr int steps = 3000;
+    int regular = 0;
+    for (int step = 0; step < steps; ++step)
+    {
+      auto pieces = (pick(100) == 0 ? 300 + pick(600) : pick(8));
+      std::string inserted;
+      for (auto count = pieces; count > 0; --count)
+        inserted += (pick(50) == 0 ? std::string("\"") : snippets[pick(snippets.size())]);
+
+      std::size_t offset = pick(text.text.size() + 1);
+      std::size_t removed = std::min(text.text.size() - offset, (pick(100) == 0 ? pick(6000) : pick(6)));
+      auto removed_text = text.text.substr(offset, removed);
+
+      // An edit that leaves an error is undone, the undo lexes everything
+      // again and the next edit starts from a text without errors
+      ++regular;
+      if (!edit(step, offset, removed, inserted))
+        edit(step, offset, inserted.size(), removed_text);
+    }
+    CHECK(0 == failed_edits);
+
+    if (!CHECK(incremental + regular / 100 >= static_cast<std::size_t>(regular)))
+      std::printf("  only %zu of %d edits were incremental\n", incremental, regular);
+  }
+
+  /// A small edit costs the same in a small and in a large text
+  void check_edit_cost()
+  {
+    std::mt19937 random(3);
+    auto pick = [&](std::size_t count) { return std::uniform_int_distribution<std::size_t>(0, count - 1)(random); };
+
+    for (std::size_t lines : { 1000, 100000 })
+    {
+      padded_text_t text;
+      for (std::size_t i = 0; i < lines; ++i)
+        text.text += "let f" + std::to_string(i) + " = (a, b) -> a * " + std::to_string(i) + " + b // commentary\n";
+
+      parsing::LiteralPool literals;
+      parsing::EditedTokens tokens(text.view(), literals);
+
+      std::size_t most = 0;
+      for (int step = 0; step < 200; ++step)
+      {
+        std::size_t offset = pick(text.text.size());
+        std::string inserted(1, "x1 (+\n"[pick(6)]);
+        text.text.insert(offset, inserted);
+        tokens.apply(text.view(), { offset, 0, inserted });
+
+        auto &cost = tokens.last_edit();
+        most = std::max(most, cost.lexed + cost.moved);
+      }
+
+      parsing::LiteralPool expected_literals;
+      CHECK(same_tokens(parsing::tokenize(text.view(), expected_literals), expected_literals, tokens.tokens(), literals));
+
+      // At most the rest of a chunk that has grown to twice its size
+      // is moved, and a few tokens around the edit are lexed again
+      if (!CHECK(most <= 1100))
+        std::printf("  an edit of %zu lines has touched %zu tokens\n", lines, most);
+    }
+  }
+}
+
+int main()
+{
+  // Random edits make lexical errors, their messages are not checked
+  std::cout.setstate(std::ios::badbit);
+
+  check_random_edits();
+  check_edit_cost();
+  return akbit::tests::finish("relexing");
+}
@@ -0,0 +1,141 @@
+// Compiling with --stream keeps one top-level statement at a time, the peak
+// memory of a large file is bounded by its largest declaration. An error in
+// the middle of the file fails the compilation and leaves no program behind.
+// Runs ./witcc
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "check.hpp"
+
+
+namespace
+{
+  /// Declarations of a few bytes that redeclare a handful of names
+  std::string small_declarations(std::size_t count)
+  {
+    std::string text;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      auto n = std::to_string(i);
+      text += "let f" + std::to_string(i % 64) + " = (a, b) -> if a > " + n + " then a * b + " + n + " else a - " + n + "\n";
+    }
+    return text;
+  }
+
+  /// A function whose body is a chain of `lines` declarations
+  std::string large_declaration(std::size_t lines)
+  {
+    std::string text = "let big = (a, b) -> {\n let x0 = a + b\n";
+    for (std::size_t i = 1; i < lines; ++i)
+      text += " let x" + std::to_string(i) + " = a * " + std::to_string(i) + " + b - x" + std::to_string(i - 1) + "\n";
+    return text + " a }\n";
+  }
+
+  struct run_t
+  {
+    /// Exit code, -1 if witcc could not be run
+    int status;
+    /// Peak resident memory in KiB
+    long peak_kib;
+  };
+
+  /// Runs `witcc --stream` on the file in the directory of the file,
+  /// where the generated program is written to
+  /// \param dump whether the tree is dumped, into `output.txt` next to the file
+  run_t compile_stream(std::filesystem::path const &witcc, std::filesystem::path const &file, bool dump)
+  {
+    auto child = fork();
+    if (0 == child)
+    {
+      auto null = open("/dev/null", O_WRONLY);
+      auto output = (dump ? open((file.parent_path() / "output.txt").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) : null);
+      dup2(output, STDOUT_FILENO);
+      dup2(null, STDERR_FILENO);
+      // A sanitized build would keep the freed statements in quarantine
+      setenv("ASAN_OPTIONS", "quarantine_size_mb=0:thread_local_quarantine_size_kb=0", 1);
+      std::vector<char const *> arguments{ "witcc", "--stream" };
+      if (!dump)
+        arguments.push_back("--skip=dump");
+      arguments.push_back(file.c_str());
+      arguments.push_back(nullptr);
+      if (0 == chdir(file.parent_path().c_str()))
+        execv(witcc.c_str(), const_cast<char * const *>(arguments.data()));
+      _exit(127);
+    }
+
+    int status = 0;
+    rusage usage{};
+    if (child < 0 || wait4(child, &status, 0, &usage) != child || !WIFEXITED(status))
+      return { -1, 0 };
+    return { WEXITSTATUS(status), usage.ru_maxrss };
+  }
+
+  /// \return peak memory of compiling the file, 0 if it has failed
+  long peak_kib(std::filesystem::path const &witcc, std::filesystem::path const &file)
+  {
+    auto run = compile_stream(witcc, file, false);
+    return (0 == run.status ? run.peak_kib : 0);
+  }
+}
+
+int main()
+{
+  namespace fs = std::filesystem;
+
+  auto witcc = fs::absolute("witcc");
+  auto directory = fs::temp_directory_path() / "witcc_stream_memory";
+  fs::create_directories(directory);
+
+  auto write = [&](char const *name, std::string const &text) {
+    auto path = directory / name;
+    std::ofstream(path, std::ios::binary) << text;
+    return path;
+  };
+
+  // The large file is the largest declaration with 4 * 10^4 small ones
+  // around it, compiled as a whole its tree takes several times as much
+  auto prelude = small_declarations(10);
+  auto largest = large_declaration(20000);
+  auto empty = peak_kib(witcc, write("empty.ws", prelude));
+  auto single = peak_kib(witcc, write("single.ws", prelude + largest));
+  auto many = peak_kib(witcc, write("many.ws", small_declarations(20000) + largest + small_declarations(20000)));
+
+  std::printf("  peak KiB: %ld without, %ld with the largest declaration, %ld with 4 * 10^4 more\n", empty, single, many);
+  if (CHECK(empty > 0 && single > empty && many > 0))
+  {
+    // What the rest of the file adds is small next to the largest declaration
+    CHECK(many - single <= (single - empty) / 4);
+  }
+
+  // A syntax error and a lexical one after statements that were written out
+  auto program = directory / "program.out.js";
+  for (auto error : { "let c = (1 +\n", "let s = \"not closed\n" })
+  {
+    fs::remove(program);
+    auto run = compile_stream(witcc, write("error.ws", small_declarations(1000) + error + small_declarations(10)), true);
+    CHECK(1 == run.status);
+    CHECK(!fs::exists(program));
+
+    std::ifstream file(directory / "output.txt");
+    std::stringstream output;
+    output << file.rdbuf();
+    CHECK(output.str().ends_with("Result: \x1b[01;41mFAILURE\x1b[49m\x1b[00;39m\n"));
+  }
+
+  // The same file without the error is compiled
+  auto run = compile_stream(witcc, write("fine.ws", small_declarations(1010)), true);
+  CHECK(0 == run.status);
+  CHECK(fs::exists(program));
+
+  fs::remove_all(directory);
+  return akbit::tests::finish("stream_memory");
+}
@@ -0,0 +1,84 @@
+// walk() visits nodes in pre-order and replaces nodes through the slots
+// their parents keep them in
+
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "session.hpp"
+#include "source.hpp"
+#include "traversal.hpp"
+#include "parsing/lexing.hpp"
+#include "parsing/literals.hpp"
+#include "parsing/parsing.hpp"
+
+
+namespace
+{
+  using namespace akbit::system;
+
+  std::vector<Node::kind_t> kinds_of(Node const * root)
+  {
+    std::vector<Node::kind_t> kinds;
+    walk(root, [&](Node const * const &node, std::size_t) {
+      if (nullptr != node) kinds.push_back(node->kind());
+    }, [](Node const * const &) { });
+    return kinds;
+  }
+
+  std::vector<std::string> integers_of(Node const * root)
+  {
+    std::vector<std::string> integers;
+    walk(root, [&](Node const * const &node, std::size_t) {
+      if (auto integer = (nullptr != node ? node->as<Node::value_integer_t>() : nullptr))
+        integers.push_back(integer->value);
+    }, [](Node const * const &) { });
+    return integers;
+  }
+}
+
+int main()
+{
+  SourceBuffer source;
+  source.assign("let x = 1 + 2 * 3\nlet y = (4, 5 - 6)\n");
+
+  parsing::LiteralPool literals;
+  auto tokens = parsing::tokenize(source.text(), literals);
+
+  Session session;
+  auto module = parsing::parse(tokens, literals, source.text(), session);
+  auto kinds = kinds_of(module);
+  CHECK((integers_of(module) == std::vector<std::string>{ "1", "2", "3", "4", "5", "6" }));
+
+  // Leaving a node replaces it, the parent sees the new node
+  std::size_t entered = 0, left = 0;
+  walk(module, [&](Node *&, std::size_t) { ++entered; }, [&](Node *&slot) {
+    ++left;
+    if (auto integer = (nullptr != slot ? slot->as<Node::value_integer_t>() : nullptr))
+      slot = session.make<Node>(Node::value_integer_t{ .value = integer->value + "0" });
+  });
+  CHECK(entered == left);
+  CHECK((integers_of(module) == std::vector<std::string>{ "10", "20", "30", "40", "50", "60" }));
+  CHECK(kinds_of(module) == kinds);
+
+  // Entering a node replaces it before its children are walked,
+  // the walk goes on with the children of the new node
+  std::vector<std::string> seen;
+  walk(module, [&](Node *&slot, std::size_t) {
+    if (nullptr != slot && slot->is<Node::binary_operation_t>() && slot->as<Node::binary_operation_t>()->operation->id == op_multiplication)
+      slot = session.make<Node>(Node::value_integer_t{ .value = "7" });
+    if (auto integer = (nullptr != slot ? slot->as<Node::value_integer_t>() : nullptr))
+      seen.push_back(integer->value);
+  }, [](Node *&) { });
+  CHECK((seen == std::vector<std::string>{ "10", "7", "40", "50", "60" }));
+  CHECK((integers_of(module) == seen));
+
+  // The root is replaced through the variable that holds it
+  Node * root = module;
+  walk(root, [](Node *&, std::size_t) { }, [&](Node *&slot) {
+    if (slot == module) slot = nullptr;
+  });
+  CHECK(nullptr == root);
+
+  return akbit::tests::finish("traversal");
+}